@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL2_gfxPrimitives.h>
+
+#include "background.h"
+#include "container.h"
+
+
+void draw_box(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool border, const int r, const int g, const int b, const int b_r, const int b_g, const int b_b)
+{
+	assert(sd->screen);
+
+	int x1 = x * sd->xsteps;
+	int y1 = y * sd->ysteps;
+	int x2 = x1 + sd->xsteps * w - 1;
+	int y2 = y1 + sd->ysteps * h - 1;
+
+	boxRGBA(sd->screen, x1, y1, x2, y2, r, g, b, 255);
+
+	if (border)
+		rectangleRGBA(sd->screen, x1, y1, x2, y2, b_r, b_g, b_b, 191);
+}
+
+background::background(const bool grid, const int n_columns, const int n_rows) : grid(grid), n_columns(n_columns), n_rows(n_rows)
+{
+}
+
+background::~background()
+{
+	if (layer)
+		SDL_DestroyTexture(layer);
+}
+
+void background::invalidate()
+{
+	valid = false;
+}
+
+// draws the static parts to the current render target
+int background::draw(screen_descriptor_t *const sd, const std::vector<container_t> & containers)
+{
+	int n_draw_calls = 0;
+
+	if (grid) {
+		for(int cy=0; cy<n_rows; cy++)
+			lineRGBA(sd->screen, 0, cy * sd->ysteps, sd->scr_w, cy * sd->ysteps, 255, 255, 255, 255);
+
+		for(int cx=0; cx<n_columns; cx++)
+			lineRGBA(sd->screen, cx * sd->xsteps, 0, cx * sd->xsteps, sd->scr_h, 255, 255, 255, 255);
+
+		n_draw_calls += n_rows + n_columns;
+	}
+
+	baked_versions.clear();
+
+	for(auto & c : containers) {
+		if (c.bg_fill) {
+			draw_box(sd, c.x, c.y, c.w, c.h, c.border, c.bg_r, c.bg_g, c.bg_b, c.b_r, c.b_g, c.b_b);
+
+			n_draw_calls += c.border ? 2 : 1;
+		}
+
+		if (c.baked) {
+			// get the version before drawing so that a concurrent update triggers a redraw
+			baked_versions.push_back(c.c->get_version());
+
+			n_draw_calls += c.c->put_static(sd, c.x, c.y, c.w, c.h, c.center_h, c.center_v);
+		}
+	}
+
+	return n_draw_calls;
+}
+
+int background::put(screen_descriptor_t *const sd, const std::vector<container_t> & containers)
+{
+	if (!supported)
+		return draw(sd, containers);
+
+	int w = 0;
+	int h = 0;
+	SDL_GetRendererOutputSize(sd->screen, &w, &h);
+
+	if (valid) {
+		size_t i = 0;
+
+		for(auto & c : containers) {
+			if (c.baked && c.c->get_version() != baked_versions.at(i++)) {
+				valid = false;
+				break;
+			}
+		}
+	}
+
+	if (layer && (w != layer_w || h != layer_h)) {
+		SDL_DestroyTexture(layer);
+		layer = nullptr;
+	}
+
+	if (!layer) {
+		layer = SDL_CreateTexture(sd->screen, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+
+		if (!layer) {
+			printf("Cannot create background layer (%s), drawing it every frame\n", SDL_GetError());
+
+			supported = false;
+
+			return draw(sd, containers);
+		}
+
+		layer_w = w;
+		layer_h = h;
+		valid   = false;
+	}
+
+	if (!valid) {
+		SDL_SetRenderTarget(sd->screen, layer);
+
+		SDL_SetRenderDrawColor(sd->screen, 0, 0, 0, 255);
+		SDL_RenderClear(sd->screen);
+
+		draw(sd, containers);
+
+		SDL_SetRenderTarget(sd->screen, nullptr);
+
+		valid = true;
+	}
+
+	SDL_RenderCopy(sd->screen, layer, nullptr, nullptr);
+
+	return 1;
+}
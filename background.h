@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <SDL2/SDL.h>
+
+#include "container.h"
+
+
+// Everything that does not change from frame to frame (grid, box
+// backgrounds and borders, boxes with a static feed) drawn once into a
+// texture which is then copied to the screen in one go.
+class background
+{
+private:
+	const bool   grid      { false   };
+	const int    n_columns { 0       };
+	const int    n_rows    { 0       };
+
+	SDL_Texture *layer     { nullptr };
+	int          layer_w   { 0       };
+	int          layer_h   { 0       };
+	bool         valid     { false   };
+	bool         supported { true    };
+
+	// content version of each baked container at the time the layer was rendered
+	std::vector<uint64_t> baked_versions;
+
+	int draw(screen_descriptor_t *const sd, const std::vector<container_t> & containers);
+
+public:
+	background(const bool grid, const int n_columns, const int n_rows);
+	virtual ~background();
+
+	void invalidate();
+
+	// returns the number of draw calls issued
+	int put(screen_descriptor_t *const sd, const std::vector<container_t> & containers);
+};
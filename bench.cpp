@@ -0,0 +1,563 @@
+// micro and macro benchmarks for the hot paths of infoviewer
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <getopt.h>
+#include <libconfig.h++>
+#include <mosquitto.h>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <turbojpeg.h>
+#include <unistd.h>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "background.h"
+#include "config.h"
+#include "container.h"
+#include "feeds.h"
+#include "feeds_mjpeg.h"
+#include "formatters.h"
+#include "frame.h"
+#include "str.h"
+#include "texture_budget.h"
+#include "timing.h"
+
+
+std::atomic_bool do_exit { false };
+
+std::mutex ttf_lock;
+
+// every heap allocation is counted to report allocations per operation
+static std::atomic_uint64_t n_allocs { 0 };
+
+void *operator new(size_t n)
+{
+	n_allocs++;
+
+	void *p = malloc(n ? n : 1);
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t n) noexcept
+{
+	free(p);
+}
+
+static int         n_repeats = 9;
+static uint64_t    min_batch_us = 20000;
+static std::string filter;
+
+// runs f in batches that take at least min_batch_us, reports the median of n_repeats batches
+static void bench(const std::string & name, const std::function<void()> & f)
+{
+	if (filter.empty() == false && name.find(filter) == std::string::npos)
+		return;
+
+	// warm up and find a batch size
+	uint64_t n = 1;
+	for(;;) {
+		uint64_t start_us = get_us();
+		for(uint64_t i=0; i<n; i++)
+			f();
+
+		if (get_us() - start_us >= min_batch_us || n >= (uint64_t(1) << 30))
+			break;
+
+		n *= 2;
+	}
+
+	std::vector<double> ns_per_op;
+	std::vector<double> allocs_per_op;
+
+	for(int r=0; r<n_repeats; r++) {
+		uint64_t allocs_start = n_allocs;
+		uint64_t start_us     = get_us();
+
+		for(uint64_t i=0; i<n; i++)
+			f();
+
+		uint64_t took_us = get_us() - start_us;
+
+		ns_per_op    .push_back(took_us * 1000. / n);
+		allocs_per_op.push_back((n_allocs - allocs_start) / double(n));
+	}
+
+	std::sort(ns_per_op.begin(), ns_per_op.end());
+	std::sort(allocs_per_op.begin(), allocs_per_op.end());
+
+	printf("%-48s %14.1f ns/op %10.2f allocs/op\n", name.c_str(), ns_per_op.at(n_repeats / 2), allocs_per_op.at(n_repeats / 2));
+	fflush(stdout);
+}
+
+// deterministic text of n bytes; variant makes two texts of the same size differ
+static std::string make_text(const size_t n, const int variant)
+{
+	static const char *const words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do", "eiusmod", "tempor" };
+	constexpr const size_t n_words = sizeof(words) / sizeof(words[0]);
+
+	std::string out;
+	size_t      i = variant;
+
+	while(out.size() < n) {
+		if (out.empty() == false)
+			out += ' ';
+
+		out += words[i++ % n_words];
+	}
+
+	out.resize(n);
+
+	return out;
+}
+
+// receives frames without showing them
+class null_container : public container
+{
+public:
+	null_container(const std::string & font_file) : container(font_file, 16, 0, false, nullptr, -1) {
+	}
+
+	virtual ~null_container() {
+	}
+
+	std::pair<int, int> set_text(const std::vector<std::string> & in_, const uint64_t arrival_us) override {
+		return { 0, 0 };
+	}
+
+	std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) override {
+		return { width, height };
+	}
+
+	void clear() override {
+	}
+
+	int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v) override {
+		return 0;
+	}
+
+	int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h) override {
+		return 0;
+	}
+};
+
+// a feed that is driven by the benchmark instead of a thread
+class bench_feed : public feed
+{
+public:
+	bench_feed(container *const c) : feed(c) {
+	}
+
+	virtual ~bench_feed() {
+	}
+
+	void operator()() override {
+	}
+};
+
+static std::vector<uint8_t> load_file(const std::string & file)
+{
+	std::vector<uint8_t> out;
+
+	FILE *fh = fopen(file.c_str(), "rb");
+	if (!fh)
+		return out;
+
+	uint8_t buffer[65536];
+	size_t  n = 0;
+	while((n = fread(buffer, 1, sizeof buffer, fh)) > 0)
+		out.insert(out.end(), buffer, buffer + n);
+
+	fclose(fh);
+
+	return out;
+}
+
+// a multipart stream as an MJPEG camera would send it, with a Content-Length per frame
+static std::vector<uint8_t> make_mjpeg_stream(const int w, const int h, const int n_frames)
+{
+	std::vector<uint8_t> out;
+
+	tjhandle compressor = tjInitCompress();
+
+	std::vector<uint8_t> rgb(w * h * 3);
+
+	for(int f=0; f<n_frames; f++) {
+		for(int y=0; y<h; y++) {
+			for(int x=0; x<w; x++) {
+				uint8_t *p = &rgb[(y * w + x) * 3];
+				p[0] = x + f * 8;
+				p[1] = y;
+				p[2] = x ^ y;
+			}
+		}
+
+		unsigned char *jpeg   = nullptr;
+		unsigned long  n_jpeg = 0;
+		if (tjCompress2(compressor, rgb.data(), w, 0, h, TJPF_RGB, &jpeg, &n_jpeg, TJSAMP_420, 80, TJFLAG_FASTDCT) == -1)
+			break;
+
+		std::string header = myformat("--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %lu\r\n\r\n", n_jpeg);
+
+		out.insert(out.end(), header.begin(), header.end());
+		out.insert(out.end(), jpeg, jpeg + n_jpeg);
+		out.push_back('\r');
+		out.push_back('\n');
+
+		tjFree(jpeg);
+	}
+
+	tjDestroy(compressor);
+
+	return out;
+}
+
+// first SOI..EOI range in a stream
+static std::vector<uint8_t> find_jpeg(const std::vector<uint8_t> & stream)
+{
+	for(size_t i=0; i + 1<stream.size(); i++) {
+		if (stream[i] != 0xff || stream[i + 1] != 0xd8)
+			continue;
+
+		for(size_t e=i + 2; e + 1<stream.size(); e++) {
+			if (stream[e] == 0xff && stream[e + 1] == 0xd9)
+				return std::vector<uint8_t>(stream.begin() + i, stream.begin() + e + 2);
+		}
+
+		break;
+	}
+
+	return { };
+}
+
+static void bench_str()
+{
+	std::string line = make_text(100, 0);
+	bench("split 100 bytes on \" \"", [&] { split(line, " "); });
+
+	std::string csv = "12.5,13.25,hello,world,42,0.001,foo,bar,baz,1000000";
+	bench("split 10 fields on \",\"", [&] { split(csv, ","); });
+
+	bench("myformat %d %s %.2f", [] { myformat("%d %s %.2f", 12345, "sensor", 21.375); });
+}
+
+static void bench_formatters()
+{
+	std::string line = "12.5 13.25 hello world 42 0.001 foo bar baz 1000000";
+
+	text_formatter as_is(std::nullopt);
+	bench("text_formatter as-is", [&] { as_is.process(line); });
+
+	text_formatter fields("fields: $field: :,:0,2,4$");
+	bench("text_formatter field", [&] { fields.process(line); });
+
+	text_formatter regex("value: $regex:,:([0-9]+)\\.([0-9]+)$");
+	bench("text_formatter regex", [&] { regex.process(line); });
+
+	std::string json = "{\"icao\":\"4841a3\",\"callsign\":\"KLM1234\",\"alt\":35000,\"speed\":452.25}";
+	json_formatter jf("icao: {jsonstr:icao}, callsign: {jsonstr:callsign}, altitude: {jsonval:alt}, speed: {jsondval:1:speed}");
+	bench("json_formatter 4 fields", [&] { jf.process(json); });
+
+	value_formatter vf(2);
+	bench("value_formatter 2 digits", [&] { vf.process("21.375"); });
+}
+
+static void bench_containers(const std::string & font_file, std::vector<container *> *const keep)
+{
+	constexpr const size_t sizes[] = { 10, 100, 1000, 10000 };
+
+	text_formatter *fmt = new text_formatter(std::nullopt);
+
+	text_box *tb = new text_box(font_file, 16, 255, 255, 255, 800, 480, true, false, fmt, -1, -1, 0);
+	keep->push_back(tb);
+
+	scroller *sc = new scroller(font_file, 1, 16, 255, 255, 255, 800, fmt, -1, false, false, "", 0);
+	keep->push_back(sc);
+
+	int t = 0;
+
+	for(auto n : sizes) {
+		// two different texts so that each update is a change
+		std::vector<std::string> text[2] { { make_text(n, 0) }, { make_text(n, 1) } };
+
+		bench(myformat("text_box::set_text %zu bytes", n), [&] { tb->set_text(text[t ^= 1], get_us()); });
+
+		bench(myformat("scroller::set_text %zu bytes", n), [&] { sc->set_text(text[t ^= 1], get_us()); });
+	}
+
+	value_box *vb = new value_box(font_file, 16, 255, 255, 255, 800, false, " W", new value_formatter(1), -1);
+	keep->push_back(vb);
+
+	std::vector<std::string> values[2] { { "1234.56" }, { "1235.67" } };
+	bench("value_box::set_text", [&] { vb->set_text(values[t ^= 1], get_us()); });
+
+	std::vector<std::string> same { make_text(100, 0) };
+	bench("text_box::set_text unchanged 100 bytes", [&] { tb->set_text(same, get_us()); });
+
+	// one box per thread, as with feeds that update at the same time; ns/op
+	// should stay flat as long as there are cores to spare
+	unsigned n_threads = std::max(2u, std::thread::hardware_concurrency());
+	std::vector<text_box *> boxes;
+
+	for(unsigned i=0; i<n_threads; i++) {
+		boxes.push_back(new text_box(font_file, 16, 255, 255, 255, 800, 480, true, false, fmt, -1, -1, 0));
+		keep->push_back(boxes.back());
+	}
+
+	for(unsigned n : { 1u, n_threads }) {
+		std::vector<std::string> text[2] { { make_text(1000, 0) }, { make_text(1000, 1) } };
+
+		bench(myformat("text_box::set_text 1000 bytes, %u in parallel", n), [&] {
+				std::vector<std::thread *> threads;
+
+				for(unsigned i=0; i<n; i++) {
+					threads.push_back(new std::thread([&, i] {
+						for(int k=0; k<16; k++)
+							boxes.at(i)->set_text(text[k & 1], get_us());
+					}));
+				}
+
+				for(auto th : threads) {
+					th->join();
+					delete th;
+				}
+			});
+	}
+}
+
+static void bench_mjpeg(const std::string & font_file, const std::string & mjpeg_file, std::vector<container *> *const keep)
+{
+	std::vector<uint8_t> stream;
+	std::string          what;
+
+	if (mjpeg_file.empty()) {
+		stream = make_mjpeg_stream(640, 480, 10);
+		what   = "synthetic";
+	}
+	else {
+		stream = load_file(mjpeg_file);
+		what   = mjpeg_file;
+
+		if (stream.empty()) {
+			fprintf(stderr, "Cannot read %s\n", mjpeg_file.c_str());
+			return;
+		}
+	}
+
+	tjhandle decompressor = tjInitDecompress();
+
+	if (font_file.empty() == false) {
+		null_container *nc = new null_container(font_file);
+		keep->push_back(nc);
+
+		bench_feed f(nc);
+
+		size_t n_frames = 0;
+
+		auto parse = [&] {
+			work_header_t wh { };
+			work_data_t   w  { };
+			w.headers           = &wh;
+			w.f                 = &f;
+			w.header            = true;
+			w.jpeg_decompressor = decompressor;
+
+			// curl hands over at most 16 kB at a time
+			constexpr const size_t chunk = 16384;
+
+			for(size_t o=0; o<stream.size(); o += chunk) {
+				size_t n = std::min(chunk, stream.size() - o);
+
+				if (write_data(&stream[o], 1, n, &w) != n)
+					break;
+			}
+
+			free(w.data);
+		};
+
+		uint64_t before = f.get_n_received();
+		parse();
+		n_frames = f.get_n_received() - before;
+
+		bench(myformat("mjpeg write_data %s (%zu frames)", what.c_str(), n_frames), parse);
+	}
+
+	std::vector<uint8_t> jpeg = find_jpeg(stream);
+	if (jpeg.empty() == false) {
+		bench("read_JPEG_memory", [&] {
+				int            w      = 0;
+				int            h      = 0;
+				unsigned char *pixels = nullptr;
+				if (read_JPEG_memory(decompressor, jpeg.data(), jpeg.size(), &w, &h, &pixels))
+					free(pixels);
+			});
+	}
+
+	tjDestroy(decompressor);
+}
+
+static void bench_frame(const std::string & cfg_file, const int w, const int h)
+{
+	libconfig::Config cfg;
+#if (LIBCONFIGXX_VER_MAJOR >= 1 && LIBCONFIGXX_VER_MINOR >= 7)
+	cfg.setOptions(libconfig::Config::Option::OptionAutoConvert);
+#else
+	cfg.setOptions(libconfig::Setting::Option::OptionAutoConvert);
+#endif
+
+	try {
+		cfg.readFile(cfg_file.c_str());
+	}
+	catch(const libconfig::FileIOException &fioex) {
+		fprintf(stderr, "I/O error while reading configuration file %s\n", cfg_file.c_str());
+		return;
+	}
+	catch(const libconfig::ParseException &pex) {
+		fprintf(stderr, "Configuration file %s parse error at line %d: %s\n", pex.getFile(), pex.getLine(), pex.getError());
+		return;
+	}
+
+	const libconfig::Setting & root   = cfg.getRoot();
+	const libconfig::Setting & global = root.lookup("global");
+
+	int  n_columns = cfg_int(global, "n-columns", "number of columns", true, 80);
+	int  n_rows    = cfg_int(global, "n-rows", "number of rows", true, 25);
+	bool grid      = cfg_bool(global, "grid", "grid", true, false);
+
+	SDL_Surface  *canvas = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer *screen = SDL_CreateSoftwareRenderer(canvas);
+
+	screen_descriptor_t sd { screen, w, h, w / n_columns, h / n_rows };
+
+	// feeds and containers keep running until the process terminates, as in infoviewer
+	std::vector<container_t> containers;
+	std::vector<feed *>      feeds;
+
+	create_instances(root, &sd, &containers, &feeds, false);
+
+	background bg(grid, n_columns, n_rows);
+
+	// let the feeds deliver their first data
+	sleep(1);
+
+	bench(myformat("full frame %s %dx%d", cfg_file.c_str(), w, h), [&] {
+			draw_frame(&sd, &bg, containers, nullptr);
+			SDL_RenderPresent(screen);
+
+			release_textures();
+		});
+}
+
+void help()
+{
+	fprintf(stderr, "infoviewer-bench [options]\n");
+	fprintf(stderr, "--font file       font for the container benchmarks (skipped when not readable)\n");
+	fprintf(stderr, "--mjpeg file      recorded multipart MJPEG stream (default: synthesized)\n");
+	fprintf(stderr, "--config file     configuration to render for the full frame benchmark\n");
+	fprintf(stderr, "--size WxH        full frame size (default: 1920x1080)\n");
+	fprintf(stderr, "--repeats n       number of measured batches, the median is reported (default: 9)\n");
+	fprintf(stderr, "--filter text     only run benchmarks with this text in their name\n");
+}
+
+int main(int argc, char *argv[])
+{
+	std::string font_file = "/usr/share/fonts/truetype/freefont/FreeMono.ttf";
+	std::string mjpeg_file;
+	std::string cfg_file;
+	int         frame_w   = 1920;
+	int         frame_h   = 1080;
+
+	static struct option long_options[] =
+	{
+		{ "font",    required_argument, nullptr, 'F' },
+		{ "mjpeg",   required_argument, nullptr, 'm' },
+		{ "config",  required_argument, nullptr, 'c' },
+		{ "size",    required_argument, nullptr, 'S' },
+		{ "repeats", required_argument, nullptr, 'r' },
+		{ "filter",  required_argument, nullptr, 'f' },
+		{ "help",    no_argument,       nullptr, 'h' },
+		{ nullptr,   0,                 nullptr, 0   }
+	};
+
+	int opt = -1;
+	while((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+		if (opt == 'F')
+			font_file = optarg;
+		else if (opt == 'm')
+			mjpeg_file = optarg;
+		else if (opt == 'c')
+			cfg_file = optarg;
+		else if (opt == 'S') {
+			if (sscanf(optarg, "%dx%d", &frame_w, &frame_h) != 2 || frame_w <= 0 || frame_h <= 0) {
+				fprintf(stderr, "--size expects WxH (e.g. 1920x1080)\n");
+				return 1;
+			}
+		}
+		else if (opt == 'r')
+			n_repeats = std::max(1, atoi(optarg));
+		else if (opt == 'f')
+			filter = optarg;
+		else {
+			help();
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+
+	if (SDL_Init(SDL_INIT_VIDEO) == -1) {
+		fprintf(stderr, "Failed to initialize SDL video subsystem\n");
+		return 1;
+	}
+
+	TTF_Init();
+
+	mosquitto_lib_init();
+
+	if (access(font_file.c_str(), R_OK) == -1) {
+		fprintf(stderr, "Font %s not readable: skipping the container benchmarks\n", font_file.c_str());
+		font_file.clear();
+	}
+
+	std::vector<container *> keep;
+
+	bench_str();
+
+	bench_formatters();
+
+	if (font_file.empty() == false)
+		bench_containers(font_file, &keep);
+
+	bench_mjpeg(font_file, mjpeg_file, &keep);
+
+	if (cfg_file.empty() == false)
+		bench_frame(cfg_file, frame_w, frame_h);
+
+	do_exit = true;
+
+	for(auto c : keep)
+		delete c;
+
+	mosquitto_lib_cleanup();
+
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,361 @@
+#include <libconfig.h++>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "container.h"
+#include "error.h"
+#include "feeds.h"
+#include "formatters.h"
+#include "str.h"
+
+
+std::string cfg_str(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const std::string & def)
+{
+	std::string v = def;
+
+	try {
+		v = (const char *)cfg.lookup(key.c_str());
+	}
+	catch(const libconfig::SettingNotFoundException &nfex) {
+		if (!optional)
+			error_exit(false, "\"%s\" not found (%s)", key.c_str(), descr);
+	}
+	catch(const libconfig::SettingTypeException & ste) {
+		error_exit(false, "Expected a string value for \"%s\" (%s) at line %d but got something else (%s)", key.c_str(), descr, cfg.getSourceLine(), ste.what());
+	}
+
+	return v;
+}
+
+double cfg_float(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const double def)
+{
+	double v = def;
+
+	try {
+		cfg.lookupValue(key.c_str(), v);
+	}
+	catch(const libconfig::SettingNotFoundException &nfex) {
+		if (!optional)
+			error_exit(false, "\"%s\" not found (%s)", key.c_str(), descr);
+	}
+	catch(const libconfig::SettingTypeException & ste) {
+		error_exit(false, "Expected a float value for \"%s\" (%s) at line %d but got something else (did you forget to add \".0\"?)", key.c_str(), descr, cfg.getSourceLine());
+	}
+
+	return v;
+}
+
+int cfg_int(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const int def)
+{
+	int v = def;
+
+	try {
+		v = cfg.lookup(key.c_str());
+	}
+	catch(const libconfig::SettingNotFoundException &nfex) {
+		if (!optional)
+			error_exit(false, "\"%s\" not found (%s)", key.c_str(), descr);
+	}
+	catch(const libconfig::SettingTypeException & ste) {
+		error_exit(false, "Expected an int value for \"%s\" (%s) at line %d but got something else", key.c_str(), descr, cfg.getSourceLine());
+	}
+
+	return v;
+}
+
+int cfg_bool(const libconfig::Setting & cfg, const char *const key, const char *descr, const bool optional, const bool def)
+{
+	bool v = def;
+
+	try {
+		v = cfg.lookup(key);
+	}
+	catch(const libconfig::SettingNotFoundException &nfex) {
+		if (!optional)
+			error_exit(false, "\"%s\" not found (%s)", key, descr);
+	}
+	catch(const libconfig::SettingTypeException & ste) {
+		error_exit(false, "Expected a boolean value for \"%s\" (%s) but got something else", key, descr);
+	}
+
+	return v;
+}
+
+// creates a container and a feed for each entry in "instances"
+void create_instances(const libconfig::Setting & root, screen_descriptor_t *const sd, std::vector<container_t> *const containers, std::vector<feed *> *const feeds, const bool replay)
+{
+	const libconfig::Setting & instances   = root["instances"];
+	size_t                     n_instances = instances.getLength();
+
+	for(size_t i=0; i<n_instances; i++) {
+		const libconfig::Setting & instance = instances[i];
+
+		std::string formatter_type = cfg_str(instance, "formatter", "json, text, value or as-is", false, "as-is");
+		base_text_formatter *tf { nullptr };
+
+		std::string format_string;
+
+		if (formatter_type == "json") {
+			std::string format_string = cfg_str(instance, "format-string", "json", false, "");
+
+			tf = new json_formatter(format_string);
+		}
+		else if (formatter_type == "as-is") {
+			tf = new text_formatter({ });
+		}
+		else if (formatter_type == "text") {
+			std::string format_string = cfg_str(instance, "format-string", "text", false, "");
+
+			tf = new text_formatter(format_string);
+		}
+		else if (formatter_type == "value") {
+			int n_digits = cfg_int(instance, "n-digits", "number of digits (0 for integer)", false, 0);
+
+			tf = new value_formatter(n_digits);
+		}
+		else {
+			error_exit(false, "\"format-string %s\" unknown", formatter_type.c_str());
+		}
+
+		container *c { nullptr };
+
+		std::string type = cfg_str(instance, "type", "scroller, static, value, graph or log", false, "static");
+
+		// a graph draws no text
+		bool has_text = type != "graph";
+
+		std::string font = has_text ? cfg_str(instance, "font", "path to font", false, "/usr/share/vlc/skins2/fonts/FreeSans.ttf") : "";
+		double font_height = has_text ? cfg_float(instance, "font-height", "font height", false, 5.0) : 0.;
+
+		int max_width = cfg_int(instance, "max-width", "max text width", false, 5);
+
+		int clear_after = cfg_int(instance, "clear-after", "clear text after (in seconds)", true, -1);
+
+		std::string color = cfg_str(instance, "fg-color", "r,g,b triple", true, "255,0,0");
+		std::vector<std::string> color_str = split(color, ",");
+		int fg_r = atoi(color_str.at(0).c_str());
+		int fg_g = atoi(color_str.at(1).c_str());
+		int fg_b = atoi(color_str.at(2).c_str());
+
+		std::string bg_color = cfg_str(instance, "bg-color", "r,g,b triple", true, "255,0,0");
+		std::vector<std::string> bg_color_str = split(bg_color, ",");
+		int bg_r = atoi(bg_color_str.at(0).c_str());
+		int bg_g = atoi(bg_color_str.at(1).c_str());
+		int bg_b = atoi(bg_color_str.at(2).c_str());
+
+		std::string b_color = cfg_str(instance, "b-color", "r,g,b triple", true, "255,0,0");
+		std::vector<std::string> b_color_str = split(b_color, ",");
+		int b_r = atoi(b_color_str.at(0).c_str());
+		int b_g = atoi(b_color_str.at(1).c_str());
+		int b_b = atoi(b_color_str.at(2).c_str());
+
+		bool bg_fill = cfg_bool(instance, "bg-fill", "fill background", true, true);
+
+		int x = cfg_int(instance, "x", "x position", false, 0);
+		int y = cfg_int(instance, "y", "y position", false, 0);
+		int w = cfg_int(instance, "w", "w position", false, 1);
+		int h = cfg_int(instance, "h", "h position", false, 1);
+
+		bool center_h = cfg_bool(instance, "center-horizontal", "center horizontal", true, true);
+		bool center_v = cfg_bool(instance, "center-vertical",   "center vertical",   true, true);
+
+		container_type_t ct;
+
+		if (type == "static") {
+			ct = ct_static;
+			bool word_wrap = cfg_bool(instance, "word-wrap", "wrap on word boundaries (else anywhere)", true, true);
+			int page_interval = cfg_int(instance, "page-interval", "show next page of lines every x seconds", true, -1);
+			int cache_entries = cfg_int(instance, "cache-entries", "number of rasterized texts kept for re-use", true, 16);
+			c = new text_box(font, sd->ysteps * font_height, fg_r, fg_g, fg_b, max_width * sd->xsteps, h * sd->ysteps - 2, word_wrap, center_h, tf, clear_after, page_interval, cache_entries);
+		}
+		else if (type == "value") {
+			ct = ct_static;
+			std::string unit = cfg_str(instance, "unit", "shown after the value", true, "");
+			c = new value_box(font, sd->ysteps * font_height, fg_r, fg_g, fg_b, max_width * sd->xsteps, center_h, unit, tf, clear_after);
+		}
+		else if (type == "graph") {
+			ct = ct_static;
+			int    history    = cfg_int  (instance, "history", "number of values shown", true, 3600);
+			bool   area       = cfg_str  (instance, "graph-style", "line or area", true, "line") == "area";
+			bool   auto_scale = cfg_bool (instance, "auto-scale", "scale to the shown values", true, true);
+			double scale_lo   = cfg_float(instance, "min", "bottom of the graph (without auto-scale)", true, 0.0);
+			double scale_hi   = cfg_float(instance, "max", "top of the graph (without auto-scale)", true, 100.0);
+			c = new graph_box(fg_r, fg_g, fg_b, w * sd->xsteps - 2, history, area, auto_scale, scale_lo, scale_hi, tf, clear_after);
+		}
+		else if (type == "log") {
+			ct = ct_static;
+			c = new log_box(font, sd->ysteps * font_height, fg_r, fg_g, fg_b, max_width * sd->xsteps, h * sd->ysteps - 2, tf, clear_after);
+		}
+		else if (type == "scroller") {
+			ct = ct_scroller;
+			int scroll_speed = cfg_int(instance, "scroll-speed", "pixel count", true, 1);
+			bool append = cfg_bool(instance, "append", "queue messages instead of replacing the text", true, false);
+			std::string separator = cfg_str(instance, "separator", "put between appended messages", true, " *** ");
+			int queue_length = cfg_int(instance, "queue-length", "maximum number of queued segments when appending", true, 256);
+			c = new scroller(font, scroll_speed, sd->ysteps * font_height, fg_r, fg_g, fg_b, max_width * sd->xsteps, tf, clear_after, center_v, append, separator, queue_length);
+		}
+		else {
+			error_exit(false, "\"type %s\" unknown", type.c_str());
+		}
+
+		if (instance.exists("color-rules")) {
+			const libconfig::Setting & s_rules = instance["color-rules"];
+			size_t n_rules = s_rules.getLength();
+
+			std::vector<color_rule_t> rules;
+
+			for(size_t i=0; i<n_rules; i++) {
+				const libconfig::Setting & s_rule = s_rules[i];
+
+				color_rule_t rule { };
+				rule.above = s_rule.exists("above");
+				if (!rule.above && !s_rule.exists("below"))
+					error_exit(false, "color rule at line %d needs either \"above\" or \"below\"", s_rule.getSourceLine());
+
+				rule.threshold = cfg_float(s_rule, rule.above ? "above" : "below", "threshold", false, 0.0);
+
+				std::vector<std::string> rule_color_str = split(cfg_str(s_rule, "color", "r,g,b triple", false, ""), ",");
+				if (rule_color_str.size() != 3)
+					error_exit(false, "color rule at line %d: \"color\" must be an r,g,b triple", s_rule.getSourceLine());
+
+				rule.col = { Uint8(atoi(rule_color_str.at(0).c_str())), Uint8(atoi(rule_color_str.at(1).c_str())), Uint8(atoi(rule_color_str.at(2).c_str())), 255 };
+
+				rules.push_back(rule);
+			}
+
+			c->set_color_rules(rules);
+		}
+
+		container_t entry { 0 };
+		entry.c        = c;
+		entry.ct       = ct;
+		entry.font_r   = fg_r;
+		entry.font_g   = fg_g;
+		entry.font_b   = fg_b;
+		entry.bg_r     = bg_r;
+		entry.bg_g     = bg_g;
+		entry.bg_b     = bg_b;
+		entry.b_r      = b_r;
+		entry.b_g      = b_g;
+		entry.b_b      = b_b;
+		entry.bg_fill  = bg_fill;
+		entry.x        = x;
+		entry.y        = y;
+		entry.w        = w;
+		entry.h        = h;
+		entry.border   = cfg_bool(instance, "border", "border", false, true);
+		entry.center_h = center_h;
+		entry.center_v = center_v;
+		entry.baked    = false;
+		entry.name     = cfg_str(instance, "name", "name in statistics", true, myformat("instance-%zu", i));
+
+		containers->push_back(entry);
+
+		const libconfig::Setting & s_feed = instance["feed"];
+		std::string feed_type = cfg_str(s_feed, "feed-type", "mqtt, exec, tail, static, mjpeg, synthetic, clock, sysstat, file or socket", false, "mqtt");
+
+		feed *f { nullptr };
+
+		if (replay && feed_type != "static") {
+			f = new replay_feed(c);
+		}
+		else if (feed_type == "mqtt") {
+			std::string host = cfg_str(s_feed, "host", "mqtt host", false, "127.0.0.1");
+			int         port = cfg_int(s_feed, "port", "mqtt port", true, 1883);
+
+			const libconfig::Setting & s_topics = s_feed["topics"];
+			size_t n_topics = s_topics.getLength();
+
+			std::vector<std::string> topics;
+
+			for(size_t i=0; i<n_topics; i++) {
+				const libconfig::Setting & s_topic = s_topics[i];
+
+				std::string topic = cfg_str(s_topic, "topic", "mqtt topic", false, "#");
+
+				topics.push_back(topic);
+			}
+
+			f = new mqtt_feed(host, port, topics, c);
+		}
+		else if (feed_type == "exec") {
+			std::string cmd = cfg_str(s_feed, "cmd", "command to invoke", false, "date");
+			int interval = cfg_int(s_feed, "interval", "exec interval (in millisecons)", true, 1000);
+
+			f = new exec_feed(cmd, interval, c);
+		}
+		else if (feed_type == "tail") {
+			std::string cmd = cfg_str(s_feed, "cmd", "command to \"tail\"", false, "tail -f /var/log/messages");
+
+			f = new tail_feed(cmd, c);
+		}
+		else if (feed_type == "static") {
+			std::string text = cfg_str(s_feed, "text", "text to display", false, "my text");
+
+			f = new static_feed(text, c);
+
+			containers->back().baked = ct == ct_static;
+		}
+		else if (feed_type == "mjpeg") {
+			std::string url = cfg_str(s_feed, "url", "MJPEG url", false, "my url");
+
+			if (type != "static")
+				error_exit(false, "mjpeg feeds can only be shown in static boxes");
+
+			f = new mjpeg_feed(url, c);
+		}
+		else if (feed_type == "synthetic") {
+			std::string mode_str = cfg_str(s_feed, "mode", "numbers, json or ticker", true, "ticker");
+			synthetic_mode_t mode = sm_ticker;
+
+			if (mode_str == "numbers")
+				mode = sm_numbers;
+			else if (mode_str == "json")
+				mode = sm_json;
+			else if (mode_str != "ticker")
+				error_exit(false, "\"mode %s\" unknown", mode_str.c_str());
+
+			std::string json_template = cfg_str(s_feed, "template", "json template", mode != sm_json, "");
+			int    size          = cfg_int  (s_feed, "size", "numbers per message or ticker length (in bytes)", true, 100);
+			double min_value     = cfg_float(s_feed, "min", "smallest random number", true, 0.0);
+			double max_value     = cfg_float(s_feed, "max", "largest random number", true, 1000.0);
+			double rate          = cfg_float(s_feed, "rate", "messages per second", true, 10.0);
+			double ramp_step     = cfg_float(s_feed, "ramp-step", "increase rate by this every ramp-interval", true, 0.0);
+			int    ramp_interval = cfg_int  (s_feed, "ramp-interval", "rate increase interval (in seconds)", true, 10);
+			int    seed          = cfg_int  (s_feed, "seed", "random seed", true, 1);
+
+			f = new synthetic_feed(mode, json_template, size, min_value, max_value, rate, ramp_step, ramp_interval, seed, c);
+		}
+		else if (feed_type == "clock") {
+			std::string format   = cfg_str(s_feed, "format", "strftime format", true, "%H:%M:%S");
+			std::string timezone = cfg_str(s_feed, "timezone", "e.g. Europe/Amsterdam, empty for local time", true, "");
+
+			f = new clock_feed(format, timezone, c);
+		}
+		else if (feed_type == "sysstat") {
+			int         interval     = cfg_int(s_feed, "interval", "how often to sample, in milliseconds", true, 1000);
+			std::string interface    = cfg_str(s_feed, "interface", "network interface, empty for all but lo", true, "");
+			int         thermal_zone = cfg_int(s_feed, "thermal-zone", "/sys/class/thermal/thermal_zone<n>", true, 0);
+
+			f = new sysstat_feed(interval, interface, thermal_zone, c);
+		}
+		else if (feed_type == "file") {
+			std::string path = cfg_str(s_feed, "path", "file to show", false, "");
+
+			f = new file_feed(path, c);
+		}
+		else if (feed_type == "socket") {
+			std::string path = cfg_str(s_feed, "path", "unix domain socket", true, "/tmp/infoviewer.sock");
+			std::string key  = cfg_str(s_feed, "key", "first line of the messages for this instance", true, entry.name);
+
+			f = new socket_feed(path, key, c);
+		}
+		else {
+			error_exit(false, "\"feed-type %s\" unknown", feed_type.c_str());
+		}
+
+		feeds->push_back(f);
+	}
+}
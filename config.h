@@ -0,0 +1,15 @@
+#include <libconfig.h++>
+#include <string>
+#include <vector>
+
+#include "container.h"
+#include "feeds.h"
+
+
+std::string cfg_str  (const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const std::string & def);
+double      cfg_float(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const double def=-1.0);
+int         cfg_int  (const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const int def=-1);
+int         cfg_bool (const libconfig::Setting & cfg, const char *const key, const char *descr, const bool optional, const bool def=false);
+
+// replay: all but static feeds are replaced by a replay_feed
+void create_instances(const libconfig::Setting & root, screen_descriptor_t *const sd, std::vector<container_t> *const containers, std::vector<feed *> *const feeds, const bool replay);
@@ -1,5 +1,11 @@
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <charconv>
+#include <cstring>
+#include <ctype.h>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -16,10 +22,15 @@
 #include "error.h"
 #include "formatters.h"
 #include "str.h"
+#include "timing.h"
+#include "trace.h"
 
 
 extern std::atomic_bool do_exit;
 
+// the color is applied when drawing, see container::apply_tint
+static const SDL_Color white { 255, 255, 255, 255 };
+
 extern std::mutex ttf_lock;
 
 extern void set_thread_name(const std::string & name);
@@ -28,7 +39,7 @@ TTF_Font * load_font(const std::string & filename, unsigned int font_height, boo
 {
         char *const real_path = realpath(filename.c_str(), NULL);
 
-        ttf_lock.lock();
+        trace_lock(ttf_lock, "wait ttf_lock");
 
         TTF_Font *font = TTF_OpenFont(real_path, font_height);
 	if (!font)
@@ -44,134 +55,242 @@ TTF_Font * load_font(const std::string & filename, unsigned int font_height, boo
         return font;
 }
 
-container::container(SDL_Renderer *const renderer, const std::string & font_file, const int font_height, const int max_width, base_text_formatter *const fmt, const int clear_after) : renderer(renderer), max_width(max_width), fmt(fmt), clear_after(clear_after)
+container::container(const std::string & font_file, const int font_height, const int max_width, const bool word_wrap, base_text_formatter *const fmt, const int clear_after) : max_width(max_width), fmt(fmt), clear_after(clear_after)
 {
-	assert(renderer);
+	if (font_file.empty() == false) {
+		font = load_font(font_file, font_height, true);
 
-	font = load_font(font_file, font_height, true);
+		layout = new text_layout(font, word_wrap);
+	}
 
-	th = new std::thread(std::ref(*this));
+	if (clear_after != -1)
+		th = new std::thread(std::ref(*this));
 }
 
 container::~container()
 {
-	for(auto & s : surfaces)
-		SDL_DestroyTexture(s);
+	stop();
 
-	th->join();
-	delete th;
+	delete layout;
+
+	delete cache;
+
+	// TTF_CloseFont uses the FreeType library object that all fonts share
+	if (font) {
+		trace_lock(ttf_lock, "wait ttf_lock");
+		TTF_CloseFont(font);
+		ttf_lock.unlock();
+	}
+}
+
+void container::stop()
+{
+	stop_lock.lock();
+	stop_flag = true;
+	stop_lock.unlock();
+
+	stop_cv.notify_all();
+
+	if (th) {
+		th->join();
+		delete th;
+
+		th = nullptr;
+	}
 }
 
+bool container::stopping() const
+{
+	return do_exit || stop_flag;
+}
+
+// clears the content when no update came in for clear_after seconds
 void container::operator()()
 {
-	if (clear_after != -1) {
-		while(!do_exit) {
-			usleep(500000);
+	std::unique_lock<std::mutex> stop_lck(stop_lock);
+
+	while(!stopping()) {
+		stop_cv.wait_for(stop_lck, std::chrono::milliseconds(500));
 
-			time_t now = time(nullptr);
+		// the derived parts may be gone already
+		if (stopping())
+			break;
 
-			lock.lock();
-			if (most_recent_update != 0 && now - most_recent_update >= clear_after) {
-				std::vector<SDL_Texture *> old = surfaces;
-				surfaces.clear();
+		stop_lck.unlock();
 
-				total_w = 0;
-				h       = 0;
+		time_t now = time(nullptr);
 
-				most_recent_update = 0;
+		trace_lock(lock, "wait container lock");
+		if (most_recent_update != 0 && now - most_recent_update >= clear_after) {
+			most_recent_update = 0;
 
-				lock.unlock();
+			lock.unlock();
 
-				for(auto & s : old)
-					SDL_DestroyTexture(s);
-			}
-			else {
-				lock.unlock();
-			}
+			clear();
 		}
+		else {
+			lock.unlock();
+		}
+
+		stop_lck.lock();
 	}
 }
 
-std::pair<int, int> container::set_text(const std::vector<std::string> & in_)
+uint64_t container::get_version() const
 {
-	std::vector<SDL_Texture *> temp_new;
+	return version;
+}
 
-	std::vector<std::string> in;
+container_timings_t container::get_timings() const
+{
+	container_timings_t t { n_updates, n_unchanged, update_us, format_us, raster_us, n_latency, latency_us, { }, { }, { }, last_update };
 
-	// new text?
-	std::string new_text;
-	for(auto t : in_) {
-		auto new_t = fmt ? fmt->process(t) : t;
-		new_text += new_t;
+	for(size_t i=0; i<n_latency_buckets; i++)
+		t.latency_hist[i] = latency_hist[i];
 
-		std::size_t lf = new_t.find("\n");
-		if (lf != std::string::npos) {
-			std::vector<std::string> parts = split(new_t, "\n");
+	if (cache)
+		t.cache = cache->get_stats();
 
-			std::copy(parts.begin(), parts.end(), std::back_inserter(in));
-		}
-		else {
-			in.push_back(new_t);
+	for(int i=0; i<n_texture_types; i++)
+		t.texture_bytes[i] = textures.get_bytes(texture_type_t(i));
+
+	return t;
+}
+
+// new content was installed
+void container::changed()
+{
+	last_update = time(nullptr);
+}
+
+// states are republished without new content (e.g. while scrolling): only
+// an arrival time that was not seen before is new content
+void container::picked_up(const uint64_t arrival_us)
+{
+	if (arrival_us == 0 || arrival_us == picked_arrival_us)
+		return;
+
+	picked_arrival_us  = arrival_us;
+	pending_arrival_us = arrival_us;
+}
+
+void container::presented(const uint64_t now_us)
+{
+	uint64_t arrival_us = pending_arrival_us;
+	if (arrival_us == 0)
+		return;
+
+	pending_arrival_us = 0;
+
+	uint64_t took = now_us - arrival_us;
+
+	latency_us += took;
+	n_latency++;
+
+	for(size_t i=0; i<n_latency_buckets; i++) {
+		if (took <= latency_bucket_us[i]) {
+			latency_hist[i]++;
+			break;
 		}
 	}
+}
 
-	if (new_text == text)
-		// no; don't re-render
-		return { total_w, h };
+void container::set_color(const int r, const int g, const int b)
+{
+	col.r = r;
+	col.g = g;
+	col.b = b;
 
-	// render new text
-	int new_total_w = 0, new_h = 0;
+	tint = (r << 16) | (g << 8) | b;
+}
+
+void container::set_color_rules(const std::vector<color_rule_t> & rules)
+{
+	color_rules = rules;
+}
+
+SDL_Color container::get_tint(const uint32_t tint)
+{
+	return { Uint8(tint >> 16), Uint8(tint >> 8), Uint8(tint), 255 };
+}
 
-	ttf_lock.lock();
-	for(auto line : in) {
-		int text_w = 0;
-		int dummy  = 0;
-		TTF_SizeUTF8(font, line.c_str(), &text_w, &dummy);
+// textures can be shared between render states: set it for each draw
+void container::apply_tint(SDL_Texture *const t, const uint32_t tint)
+{
+	SDL_Color c = get_tint(tint);
 
-		int    divider = ceil(double(text_w) / max_width);
-		size_t n_chars = ceil(line.size() / double(divider));
+	SDL_SetTextureColorMod(t, c.r, c.g, c.b);
+}
 
-		for(int i=0; i<divider; i++) {
-			std::string part = line.substr(0, n_chars);
-			if (part.empty())
-				break;
+// the first number in the text, if any
+static bool first_number(const std::string & text, double *const v)
+{
+	for(size_t i=0; i<text.size(); i++) {
+		bool start = isdigit(text[i]) || ((text[i] == '-' || text[i] == '.') && i + 1 < text.size() && isdigit(text[i + 1]));
+
+		if (start)
+			return std::from_chars(text.data() + i, text.data() + text.size(), *v).ec == std::errc();
+	}
+
+	return false;
+}
+
+void container::account_update(const uint64_t start_us)
+{
+	update_us += get_us() - start_us;
+	n_updates++;
+}
+
+bool container::format_text(const std::vector<std::string> & in_, std::string *const new_text, std::vector<std::string> *const lines, uint32_t *const new_tint, const bool repeats_are_new)
+{
+	uint64_t start_us = get_us();
 
-			line.erase(0, n_chars);
+	TRACE_SPAN("format");
 
-			SDL_Surface *new_s = TTF_RenderUTF8_Blended(font, part.c_str(), col);
-			assert(new_s);
-			SDL_Texture *new_t = SDL_CreateTextureFromSurface(renderer, new_s);
-			assert(new_t);
+	for(auto t : in_) {
+		auto new_t = fmt ? fmt->process(t) : t;
+		*new_text += new_t + "\n";
 
-			temp_new.push_back(new_t);
-			new_total_w += new_s->w;
-			new_h = std::max(new_h, new_s->h);
+		std::size_t lf = new_t.find("\n");
+		if (lf != std::string::npos) {
+			std::vector<std::string> parts = split(new_t, "\n");
 
-			SDL_FreeSurface(new_s);
+			std::copy(parts.begin(), parts.end(), std::back_inserter(*lines));
+		}
+		else {
+			lines->push_back(new_t);
 		}
 	}
-	ttf_lock.unlock();
 
-	// swap
+	// the first rule that matches wins, else the fg-color
+	SDL_Color c     = col;
+	double    value = 0.;
 
-	lock.lock();
+	if (color_rules.empty() == false && first_number(*new_text, &value)) {
+		for(auto & rule : color_rules) {
+			if (rule.above ? value > rule.threshold : value < rule.threshold) {
+				c = rule.col;
+				break;
+			}
+		}
+	}
 
-	std::vector<SDL_Texture *> old = surfaces;
+	// the color follows from the text: same text, same color
+	*new_tint = (c.r << 16) | (c.g << 8) | c.b;
 
-	surfaces = temp_new;
-	total_w = new_total_w;
-	h = new_h;
+	format_us += get_us() - start_us;
 
-	most_recent_update = time(nullptr);
+	if (repeats_are_new)
+		return true;
 
+	trace_lock(lock, "wait container lock");
+	bool changed = *new_text != text;
 	lock.unlock();
 
-	// delete old
-
-	for(auto & s : old)
-		SDL_DestroyTexture(s);
+	if (!changed)
+		n_unchanged++;
 
-	return { total_w, h };
+	return changed;
 }
 
 SDL_Surface *create_surface_from_rgb_pixels(const uint8_t *const pixels, const int width, const int height)
@@ -187,8 +306,222 @@ SDL_Surface *create_surface_from_rgb_pixels(const uint8_t *const pixels, const i
     return SDL_CreateRGBSurfaceFrom((void *)pixels, width, height, depth, pitch, rmask, gmask, bmask, amask);
 }
 
-std::pair<int, int> container::set_pixels(const uint8_t *const rgb_pixels, const int width, const int height)
+// upper limit of the number of (wrapped) lines a text_box keeps around
+constexpr const size_t max_stored_lines = 1024;
+
+text_box::text_box(const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, const int max_height, const bool word_wrap, const bool center_h, base_text_formatter *const fmt, const int clear_after, const int page_interval, const size_t cache_entries) :
+	container(font_file, font_height, max_width, word_wrap, fmt, clear_after), center_h(center_h), page_interval(page_interval)
+{
+	set_color(r, g, b);
+
+	trace_lock(font_lock, "wait font lock");
+	int font_h = std::max(1, TTF_FontHeight(font));
+	font_lock.unlock();
+
+	// when paging, only show complete lines; else the last one may be partially visible
+	if (page_interval > 0)
+		lines_per_page = std::max(1, max_height / font_h);
+	else
+		lines_per_page = std::max(1, (max_height + font_h - 1) / font_h);
+
+	if (cache_entries > 0)
+		cache = new texture_cache(cache_entries);
+
+	if (page_interval > 0)
+		th = new std::thread(std::ref(*this));
+}
+
+text_box::~text_box()
+{
+	stop();
+
+	if (th) {
+		th->join();
+		delete th;
+	}
+}
+
+// all lines in one texture, aligned relative to each other
+std::shared_ptr<texture> text_box::compose(const std::vector<SDL_Surface *> & lines, const int w, const int h)
+{
+	if (lines.empty())
+		return { };
+
+	SDL_Surface *out = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+	assert(out);
+
+	int y = 0;
+
+	for(auto & s : lines) {
+		// copy the alpha channel as-is instead of blending it with the (empty) target
+		SDL_SetSurfaceBlendMode(s, SDL_BLENDMODE_NONE);
+
+		SDL_Rect dest { center_h ? (w - s->w) / 2 : 0, y, s->w, s->h };
+		SDL_BlitSurface(s, nullptr, out, &dest);
+
+		y += s->h;
+	}
+
+	// uploaded by the render thread
+	return textures.create(out, tt_text);
+}
+
+// installs new_t unless the content was replaced while it was being rendered
+void text_box::swap_texture(const std::shared_ptr<texture> & new_t, const int new_w, const int new_h, const int new_line_h, const bool is_text, const uint64_t gen, const uint64_t arrival_us)
+{
+	trace_lock(lock, "wait container lock");
+
+	if (gen != generation) {
+		lock.unlock();
+
+		return;
+	}
+
+	total_w = new_w;
+	h       = new_h;
+
+	states.write_slot() = { new_t, new_w, new_h, new_line_h, is_text, tint, arrival_us };
+	states.publish();
+
+	// what is now in the write slot is no longer used by the renderer;
+	// release it outside of the lock
+	std::shared_ptr<texture> old = std::move(states.write_slot().t);
+
+	version++;
+
+	if (arrival_us)
+		changed();
+
+	lock.unlock();
+}
+
+// rasterizes the lines of one page only
+std::pair<int, int> text_box::render_page(const std::vector<std::string> & page_lines, const uint64_t gen, const uint64_t arrival_us)
+{
+	TRACE_SPAN("rasterize");
+
+	uint64_t start_us = get_us();
+
+	std::string key;
+	if (cache) {
+		for(auto & line : page_lines)
+			key += line + "\n";
+
+		texture_cache::entry_t e;
+		if (cache->get(key, &e)) {
+			raster_us += get_us() - start_us;
+
+			swap_texture(e.t, e.w, e.h, e.line_h, true, gen, arrival_us);
+
+			return { e.w, e.h };
+		}
+	}
+
+	std::vector<SDL_Surface *> surfaces;
+	int new_w = 0, new_h = 0, new_line_h = 0;
+
+	trace_lock(font_lock, "wait font lock");
+	for(auto & line : page_lines) {
+		SDL_Surface *new_s = TTF_RenderUTF8_Blended(font, line.c_str(), white);
+		assert(new_s);
+
+		surfaces.push_back(new_s);
+
+		new_w      = std::max(new_w, new_s->w);
+		new_h     += new_s->h;
+		new_line_h = std::max(new_line_h, new_s->h);
+	}
+	font_lock.unlock();
+
+	std::shared_ptr<texture> new_t = compose(surfaces, new_w, new_h);
+
+	for(auto & s : surfaces)
+		SDL_FreeSurface(s);
+
+	if (cache)
+		cache->put(key, { new_t, new_w, new_h, new_line_h });
+
+	raster_us += get_us() - start_us;
+
+	swap_texture(new_t, new_w, new_h, new_line_h, true, gen, arrival_us);
+
+	return { new_w, new_h };
+}
+
+// lock must be held
+std::vector<std::string> text_box::get_page(const size_t nr) const
+{
+	size_t start = nr * lines_per_page;
+	size_t end   = std::min(lines.size(), start + lines_per_page);
+
+	if (start >= end)
+		return { };
+
+	return std::vector<std::string>(lines.begin() + start, lines.begin() + end);
+}
+
+std::pair<int, int> text_box::set_text(const std::vector<std::string> & in_, const uint64_t arrival_us)
+{
+	TRACE_SPAN("set_text");
+
+	uint64_t start_us = get_us();
+
+	std::vector<std::string> in;
+
+	std::string new_text;
+	uint32_t    new_tint = 0;
+	if (format_text(in_, &new_text, &in, &new_tint, false) == false) {
+		account_update(start_us);
+
+		return { total_w, h };
+	}
+
+	trace_lock(font_lock, "wait font lock");
+	std::vector<std::string> laid_out = layout->layout(in, max_width);
+	font_lock.unlock();
+
+	std::vector<std::string> new_lines;
+	for(auto & line : laid_out) {
+		if (line.empty())
+			continue;
+
+		new_lines.push_back(line);
+
+		if (new_lines.size() >= max_stored_lines)
+			break;
+	}
+
+	trace_lock(lock, "wait container lock");
+
+	// without paging, lines that will never be shown are not kept
+	if (page_interval <= 0 && new_lines.size() > size_t(lines_per_page))
+		new_lines.resize(lines_per_page);
+
+	lines    = std::move(new_lines);
+	page     = 0;
+	text     = new_text;
+	tint     = new_tint;
+	uint64_t gen = ++generation;
+
+	std::vector<std::string> page_lines = get_page(0);
+
+	most_recent_update = time(nullptr);
+
+	lock.unlock();
+
+	auto rc = render_page(page_lines, gen, arrival_us);
+
+	account_update(start_us);
+
+	return rc;
+}
+
+std::pair<int, int> text_box::set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us)
 {
+	TRACE_SPAN("set_pixels");
+
+	uint64_t start_us = get_us();
+
 	SDL_Surface *input = create_surface_from_rgb_pixels(rgb_pixels, width, height);
 	if (width > max_width) {
 		float factor = width / max_width;
@@ -196,184 +529,1265 @@ std::pair<int, int> container::set_pixels(const uint8_t *const rgb_pixels, const
 		SDL_FreeSurface(input);
 		input = temp;
 	}
-	std::vector<SDL_Texture *> temp_new { SDL_CreateTextureFromSurface(renderer, input) };
+
+	// refers to rgb_pixels (unless shrunk): the render thread uploads a copy
+	SDL_Surface *copy = SDL_ConvertSurfaceFormat(input, SDL_PIXELFORMAT_ARGB8888, 0);
 	SDL_FreeSurface(input);
 
-	// swap
-	lock.lock();
+	if (!copy) {
+		account_update(start_us);
+
+		return { total_w, h };
+	}
+
+	int new_w = copy->w;
+	int new_h = copy->h;
 
-	std::vector<SDL_Texture *> old = surfaces;
+	std::shared_ptr<texture> new_t = textures.create(copy, tt_image);
 
-	surfaces = temp_new;
-	total_w  = width;
-	h        = height;
+	raster_us += get_us() - start_us;
 
+	trace_lock(lock, "wait container lock");
+	lines.clear();
+	text.clear();
+	uint64_t gen = ++generation;
 	most_recent_update = time(nullptr);
-
 	lock.unlock();
 
-	// delete old
-	for(auto & s : old)
-		SDL_DestroyTexture(s);
+	swap_texture(new_t, new_w, new_h, new_h, false, gen, arrival_us);
+
+	account_update(start_us);
 
-	return { width, height };
+	return { new_w, new_h };
 }
 
-text_box::text_box(SDL_Renderer * const renderer, const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, base_text_formatter *const fmt, const int clear_after) : container(renderer, font_file, font_height, max_width, fmt, clear_after)
+void text_box::clear()
 {
-	col.r = r;
-	col.g = g;
-	col.b = b;
+	trace_lock(lock, "wait container lock");
+	lines.clear();
+	text.clear();
+	uint64_t gen = ++generation;
+	lock.unlock();
+
+	swap_texture({ }, 0, 0, 0, false, gen, 0);
 }
 
-text_box::~text_box()
+// flips to the next page every page_interval seconds
+void text_box::operator()()
 {
+	set_thread_name("pager");
+
+	time_t next_flip = time(nullptr) + page_interval;
+
+	while(!stopping()) {
+		usleep(100000);
+
+		if (time(nullptr) < next_flip)
+			continue;
+
+		next_flip += page_interval;
+
+		trace_lock(lock, "wait container lock");
+
+		size_t n_pages = (lines.size() + lines_per_page - 1) / lines_per_page;
+		if (n_pages <= 1) {
+			lock.unlock();
+			continue;
+		}
+
+		page = (page + 1) % n_pages;
+
+		std::vector<std::string> page_lines = get_page(page);
+		uint64_t gen = generation;
+
+		lock.unlock();
+
+		render_page(page_lines, gen, 0);
+	}
 }
 
-void text_box::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
+int text_box::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
 {
 	assert(0);
+
+	return 0;
 }
 
-void text_box::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
+int text_box::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
 {
-	lock.lock();
+	int n_draw_calls = 0;
 
-	int biggest_w = 0;
-	int biggest_h = 0;
+	if (states.update())
+		dest_valid = false;
 
-	for(auto & p : surfaces) {
-		Uint32 format = 0;
-		int    access = 0;
-		int    w      = 0;
-		int    h      = 0;
+	const render_state_t & s = states.read_slot();
 
-		int    rc     = SDL_QueryTexture(p, &format, &access, &w, &h);
-		assert(rc == 0);
+	picked_up(s.arrival_us);
 
-		biggest_w = std::max(biggest_w, w);
-		biggest_h = std::max(biggest_h, h);
-	}
+	if (s.t) {
+		// only changes when the texture does
+		if (!dest_valid) {
+			const int put_x = x * sd->xsteps + 1;
+			const int put_y = y * sd->ysteps + 1;
 
-	const int put_x  = x * sd->xsteps + 1;
-	int       put_y  = y * sd->ysteps + 1;
+			const int put_w = w * sd->xsteps - 2;
+			const int put_h = h * sd->ysteps - 2;
 
-	const int put_w  = w * sd->xsteps - 2;
-	int       work_h = h * sd->ysteps - 2;
+			int cur_x = center_h ? put_x + put_w / 2 - s.w / 2 : put_x;
+			int cur_y = center_v ? put_y + s.line_h / 4 : put_y;
 
-	for(auto & p : surfaces) {
-		Uint32 format = 0;
-		int    access = 0;
-		int    w      = 0;
-		int    h      = 0;
-		int    rc     = SDL_QueryTexture(p, &format, &access, &w, &h);
-		assert(rc == 0);
+			int vis_h = std::max(0, std::min(s.h, put_y + put_h - cur_y));
 
-		int     cur_x = center_h ? put_x + put_w / 2 - w / 2 : put_x;
-		int     cur_y = center_v ? put_y + biggest_h / 4 : put_y;
+			src  = { 0, 0, s.w, vis_h };
+			dest = { cur_x, cur_y, s.w, vis_h };
 
-		SDL_Rect dest { cur_x, cur_y, w, h };
-		SDL_Rect src  { 0, 0, w, h };
+			dest_valid = true;
+		}
 
-		SDL_RenderCopy(sd->screen, p, &src, &dest);
+		SDL_Texture *t = s.t->get(sd->screen);
 
-		put_y  += h;
-		work_h -= h;
+		if (t) {
+			if (s.is_text)
+				apply_tint(t, s.tint);
 
-		if (work_h <= 0)
-			break;
+			SDL_RenderCopy(sd->screen, t, &src, &dest);
+			n_draw_calls++;
+		}
 	}
 
-	lock.unlock();
+	return n_draw_calls;
 }
 
-scroller::scroller(SDL_Renderer * const renderer, const std::string & font_file, const int scroll_speed, const int font_height, const int r, const int g, const int b, const int max_width, base_text_formatter *const fmt, const int clear_after, const bool center_v) :
-	container(renderer, font_file, font_height, max_width, fmt, clear_after), scroll_speed(scroll_speed),
-	center_v(center_v)
-{
-	assert(renderer);
+// longer texts are cut into segments of at most this many pixels wide
+constexpr const int segment_w = 512;
 
-	col.r = r;
-	col.g = g;
-	col.b = b;
+scroller::scroller(const std::string & font_file, const int scroll_speed, const int font_height, const int r, const int g, const int b, const int max_width, base_text_formatter *const fmt, const int clear_after, const bool center_v, const bool append, const std::string & separator, const size_t max_queue) :
+	container(font_file, font_height, max_width, false, fmt, clear_after), scroll_speed(scroll_speed),
+	center_v(center_v), append(append), separator(separator), max_queue(max_queue)
+{
+	set_color(r, g, b);
 
 	th = new std::thread(std::ref(*this));
 }
 
 scroller::~scroller()
 {
+	stop();
+
 	th->join();
 	delete th;
 }
 
-void scroller::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
+std::pair<int, int> scroller::set_text(const std::vector<std::string> & in_, const uint64_t arrival_us)
 {
-	assert(0);
-}
+	TRACE_SPAN("set_text");
 
-void scroller::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
-{
-	lock.lock();
+	uint64_t start_us = get_us();
 
-	if (!surfaces.empty()) {
-		SDL_Rect dest { x * sd->xsteps + 1, y * sd->ysteps + 1, sd->xsteps * put_w, sd->ysteps * put_h };
-		int cur_render_x = render_x;
-		int pixels_to_do = sd->xsteps * put_w;
+	std::vector<std::string> in;
 
-		do {
-			for(auto & p : surfaces) {
-				Uint32 format = 0;
-				int access = 0;
-				int w = 0;
-				int h = 0;
-				int rc = SDL_QueryTexture(p, &format, &access, &w, &h);
-				assert(rc == 0);
+	// when appending, the same message again is queued again
+	std::string new_text;
+	uint32_t    new_tint = 0;
+	if (format_text(in_, &new_text, &in, &new_tint, append) == false) {
+		account_update(start_us);
 
-				if (w <= cur_render_x) {
-					cur_render_x -= w;
-					continue;
-				}
+		return { total_w, h };
+	}
 
-				SDL_Rect cur_src { cur_render_x, 0, w - cur_render_x, h };
-				cur_render_x = 0;
+	if (append && in.empty() == false)
+		in.back() += separator;
 
-				SDL_Rect dest_temp { 0 };
+	// only measure here; rasterizing happens when a segment comes into view
+	std::vector<segment_t> new_segments;
+	int new_total_w = 0, new_h = 0;
 
-				if (center_v) {
-					dest_temp = { dest.x, dest.y + sd->ysteps * put_h / 2 - h / 2, std::min(dest.w, cur_src.w), sd->ysteps * put_h };
-				}
-				else {
-					dest_temp = { dest.x, dest.y, std::min(dest.w, cur_src.w), sd->ysteps * put_h };
-				}
+	uint64_t raster_start_us = get_us();
 
-				SDL_RenderCopy(sd->screen, p, &cur_src, &dest_temp);
-				dest.x += cur_src.w;
-				pixels_to_do -= cur_src.w;
+	trace_lock(font_lock, "wait font lock");
+	for(auto & part : layout->layout(in, segment_w)) {
+		if (part.empty())
+			continue;
 
-				if (pixels_to_do <= 0)
-					break;
-			}
-		}
-		while(pixels_to_do > 0);
+		int text_w = 0, text_h = 0;
+		TTF_SizeUTF8(font, part.c_str(), &text_w, &text_h);
+
+		new_segments.push_back({ part, new_total_w, text_w, text_h, { }, new_tint, arrival_us });
+
+		new_total_w += text_w;
+		new_h        = std::max(new_h, text_h);
 	}
+	font_lock.unlock();
 
-	lock.unlock();
-}
+	raster_us += get_us() - raster_start_us;
 
-void scroller::operator()() {
-	set_thread_name("scroller");
+	trace_lock(lock, "wait container lock");
 
-	while(!do_exit) {
-		usleep(10000);
+	if (append) {
+		if (segments.size() + new_segments.size() > max_queue) {
+			// the scroller can't keep up: drop the message
+			n_dropped++;
 
-		lock.lock();
+			report_nth(n_dropped, "scroller queue full, %lu messages dropped\n", n_dropped);
 
-		if (total_w > 0) {
+			lock.unlock();
 
-			render_x += scroll_speed;
-			render_x %= total_w;
+			account_update(start_us);
+
+			return { total_w, h };
 		}
 
-		lock.unlock();
-	}
+		// directly behind the queue, but never in view: scroll in from the right
+		int vis_w = visible_w;
+		int start = render_x + (vis_w > 0 ? vis_w : max_width);
+
+		if (segments.empty() == false)
+			start = std::max(start, segments.back().x + segments.back().w);
+
+		for(auto & seg : new_segments) {
+			seg.x += start;
+			segments.push_back(std::move(seg));
+		}
+
+		total_w += new_total_w;
+		h        = std::max(h, new_h);
+		text     = new_text;
+		tint     = new_tint;
+
+		publish_state();
+
+		version++;
+
+		changed();
+
+		most_recent_update = time(nullptr);
+
+		lock.unlock();
+
+		account_update(start_us);
+
+		return { total_w, h };
+	}
+
+	std::vector<segment_t> old = std::move(segments);
+
+	segments = std::move(new_segments);
+	resident.clear();
+	generation++;
+
+	total_w  = new_total_w;
+	h        = new_h;
+	text     = new_text;
+	tint     = new_tint;
+
+	render_x = total_w > 0 ? render_x % total_w : 0;
+	cur_segment = 0;
+	advance_cursor();
+
+	publish_state();
+
+	version++;
+
+	changed();
+
+	most_recent_update = time(nullptr);
+
+	lock.unlock();
+
+	// textures are released when the last state that shows them is overwritten
+	old.clear();
+
+	account_update(start_us);
+
+	return { new_total_w, new_h };
+}
+
+std::pair<int, int> scroller::set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us)
+{
+	assert(0);
+
+	return { 0, 0 };
+}
+
+void scroller::clear()
+{
+	trace_lock(lock, "wait container lock");
+
+	std::vector<segment_t> old = std::move(segments);
+
+	segments.clear();
+	resident.clear();
+	generation++;
+
+	total_w     = 0;
+	h           = 0;
+	text.clear();
+	render_x    = 0;
+	cur_segment = 0;
+
+	publish_state();
+
+	version++;
+
+	lock.unlock();
+
+	old.clear();
+}
+
+// lock must be held
+void scroller::advance_cursor()
+{
+	if (segments.empty()) {
+		cur_segment = 0;
+		return;
+	}
+
+	// render_x wrapped around
+	if (cur_segment >= segments.size() || segments[cur_segment].x > render_x)
+		cur_segment = 0;
+
+	while(render_x >= segments[cur_segment].x + segments[cur_segment].w && cur_segment + 1 < segments.size())
+		cur_segment++;
+}
+
+// append mode: removes the segments that scrolled out of view
+// lock must be held
+void scroller::drop_scrolled()
+{
+	size_t n = 0;
+
+	while(n < segments.size() && segments[n].x + segments[n].w <= render_x) {
+		total_w -= segments[n].w;
+		n++;
+	}
+
+	if (n == 0)
+		return;
+
+	segments.erase(segments.begin(), segments.begin() + n);
+
+	std::vector<size_t> new_resident;
+	for(auto r : resident) {
+		if (r >= n)
+			new_resident.push_back(r - n);
+	}
+	resident = new_resident;
+
+	// keep the coordinates small; the strip is as high as the highest
+	// segment that is left
+	h = 0;
+
+	for(auto & seg : segments) {
+		seg.x -= render_x;
+
+		h = std::max(h, seg.h);
+	}
+
+	render_x    = 0;
+	cur_segment = 0;
+}
+
+// makes sure the segments that are visible (or will be soon) have a
+// texture and releases the ones that scrolled out of view
+void scroller::rasterize_window()
+{
+	std::vector<std::pair<size_t, std::string> > todo;
+	std::vector<std::shared_ptr<texture> > release;
+
+	trace_lock(lock, "wait container lock");
+
+	if (segments.empty() || total_w == 0) {
+		lock.unlock();
+		return;
+	}
+
+	uint64_t gen      = generation;
+	int      vis_w    = visible_w;
+	int      window_w = (vis_w > 0 ? vis_w : max_width) + segment_w;
+
+	std::vector<size_t> window;
+
+	if (append) {
+		// segments are not contiguous, nor do they wrap around
+		for(size_t i=0; i<segments.size() && segments[i].x - render_x < window_w; i++) {
+			window.push_back(i);
+
+			if (!segments[i].t)
+				todo.push_back({ i, segments[i].text });
+		}
+	}
+	else {
+		size_t idx = cur_segment;
+		int    covered = segments[idx].x - render_x;
+
+		while(covered < window_w && window.size() < segments.size()) {
+			window.push_back(idx);
+
+			if (!segments[idx].t)
+				todo.push_back({ idx, segments[idx].text });
+
+			covered += segments[idx].w;
+			idx = (idx + 1) % segments.size();
+		}
+	}
+
+	std::vector<size_t> new_resident;
+	for(auto & r : resident) {
+		if (std::find(window.begin(), window.end(), r) == window.end())
+			release.push_back(std::move(segments[r].t));
+		else {
+			new_resident.push_back(r);
+		}
+	}
+	resident = new_resident;
+
+	if (release.empty() == false)
+		publish_state();
+
+	lock.unlock();
+
+	release.clear();
+
+	if (todo.empty())
+		return;
+
+	std::vector<std::pair<size_t, std::shared_ptr<texture> > > rendered;
+
+	TRACE_SPAN("rasterize");
+
+	uint64_t start_us = get_us();
+
+	trace_lock(font_lock, "wait font lock");
+	for(auto & entry : todo) {
+		SDL_Surface *new_s = TTF_RenderUTF8_Blended(font, entry.second.c_str(), white);
+		assert(new_s);
+
+		rendered.push_back({ entry.first, textures.create(new_s, tt_text) });
+	}
+	font_lock.unlock();
+
+	raster_us += get_us() - start_us;
+
+	trace_lock(lock, "wait container lock");
+
+	for(auto & entry : rendered) {
+		// text was replaced in the mean time: released with 'rendered'
+		if (gen != generation || segments.at(entry.first).t)
+			continue;
+
+		segments.at(entry.first).t = entry.second;
+		resident.push_back(entry.first);
+	}
+
+	publish_state();
+
+	lock.unlock();
+}
+
+// lock must be held
+void scroller::publish_state()
+{
+	render_state_t & s = states.write_slot();
+
+	// reuses the allocation of a previous state
+	s.pieces.clear();
+	s.h = h;
+
+	// content only counts as shown when all of it that is in view is
+	bool     complete = true;
+	uint64_t newest   = 0;
+
+	if (append) {
+		int vis_w = visible_w;
+		int end_x = render_x + (vis_w > 0 ? vis_w : max_width);
+
+		for(auto & seg : segments) {
+			if (seg.x >= end_x)
+				break;
+
+			int start = std::max(seg.x, render_x);
+			int end   = std::min(seg.x + seg.w, end_x);
+
+			if (end <= start)
+				continue;
+
+			if (seg.t) {
+				s.pieces.push_back({ seg.t, start - seg.x, start - render_x, end - start, seg.tint });
+
+				newest = std::max(newest, seg.arrival_us);
+			}
+			else {
+				complete = false;
+			}
+		}
+	}
+	else if (total_w > 0) {
+		int    vis_w        = visible_w;
+		int    pixels_to_do = vis_w > 0 ? vis_w : max_width;
+		size_t idx          = cur_segment;
+		int    offset       = render_x - segments[idx].x;
+		int    x            = 0;
+
+		while(pixels_to_do > 0) {
+			const segment_t & seg = segments[idx];
+
+			int cur_w = std::min(seg.w - offset, pixels_to_do);
+
+			// not rasterized yet: leave its space empty
+			if (cur_w > 0) {
+				if (seg.t) {
+					s.pieces.push_back({ seg.t, offset, x, cur_w, seg.tint });
+
+					newest = std::max(newest, seg.arrival_us);
+				}
+				else {
+					complete = false;
+				}
+			}
+
+			x            += cur_w;
+			pixels_to_do -= cur_w;
+
+			offset = 0;
+			idx    = (idx + 1) % segments.size();
+		}
+	}
+
+	if (complete && newest > shown_arrival_us)
+		shown_arrival_us = newest;
+
+	s.arrival_us = shown_arrival_us;
+
+	states.publish();
+}
+
+int scroller::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
+{
+	assert(0);
+
+	return 0;
+}
+
+int scroller::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
+{
+	int n_draw_calls = 0;
+
+	visible_w = sd->xsteps * put_w;
+
+	states.update();
+
+	const render_state_t & s = states.read_slot();
+
+	picked_up(s.arrival_us);
+
+	int dest_x = x * sd->xsteps + 1;
+	int dest_y = y * sd->ysteps + 1;
+	int box_h  = sd->ysteps * put_h;
+	int draw_h = std::min(s.h, box_h);
+
+	if (center_v)
+		dest_y += box_h / 2 - draw_h / 2;
+
+	for(auto & p : s.pieces) {
+		SDL_Rect src  { p.src_x, 0, p.w, draw_h };
+		SDL_Rect dest { dest_x + p.x, dest_y, p.w, draw_h };
+
+		SDL_Texture *t = p.t->get(sd->screen);
+		if (!t)
+			continue;
+
+		apply_tint(t, p.tint);
+
+		SDL_RenderCopy(sd->screen, t, &src, &dest);
+		n_draw_calls++;
+	}
+
+	return n_draw_calls;
+}
+
+void scroller::operator()() {
+	set_thread_name("scroller");
+
+	while(!stopping()) {
+		usleep(10000);
+
+		trace_lock(lock, "wait container lock");
+
+		if (append) {
+			if (segments.empty() == false) {
+				render_x += scroll_speed;
+
+				drop_scrolled();
+
+				publish_state();
+			}
+		}
+		else if (total_w > 0) {
+			render_x += scroll_speed;
+			render_x %= total_w;
+
+			advance_cursor();
+
+			publish_state();
+		}
+
+		lock.unlock();
+
+		rasterize_window();
+	}
+}
+
+value_box::value_box(const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, const bool center_h, const std::string & unit, base_text_formatter *const fmt, const int clear_after) :
+	container(font_file, font_height, max_width, false, fmt, clear_after), center_h(center_h)
+{
+	set_color(r, g, b);
+
+	std::vector<SDL_Surface *> surfaces;
+	int atlas_w = 0;
+	int digit_w = 0;
+
+	trace_lock(font_lock, "wait font lock");
+
+	for(size_t i=0; i<n_glyphs; i++) {
+		const char text[] = { glyph_chars[i], 0x00 };
+
+		SDL_Surface *s = TTF_RenderUTF8_Blended(font, text, white);
+		assert(s);
+
+		surfaces.push_back(s);
+
+		if (glyph_chars[i] >= '0' && glyph_chars[i] <= '9')
+			digit_w = std::max(digit_w, s->w);
+	}
+
+	SDL_Surface *unit_s = unit.empty() ? nullptr : TTF_RenderUTF8_Blended(font, unit.c_str(), white);
+
+	font_lock.unlock();
+
+	for(size_t i=0; i<n_glyphs; i++) {
+		SDL_Surface *s = surfaces[i];
+
+		glyph_src[i]     = { atlas_w, 0, s->w, s->h };
+		glyph_advance[i] = glyph_chars[i] >= '0' && glyph_chars[i] <= '9' ? digit_w : s->w;
+
+		atlas_w += s->w;
+		glyph_h  = std::max(glyph_h, s->h);
+	}
+
+	if (unit_s) {
+		unit_src = { atlas_w, 0, unit_s->w, unit_s->h };
+
+		atlas_w += unit_s->w;
+		glyph_h  = std::max(glyph_h, unit_s->h);
+
+		surfaces.push_back(unit_s);
+	}
+
+	SDL_Surface *out = SDL_CreateRGBSurfaceWithFormat(0, atlas_w, glyph_h, 32, SDL_PIXELFORMAT_ARGB8888);
+	assert(out);
+
+	int x = 0;
+	for(auto & s : surfaces) {
+		SDL_SetSurfaceBlendMode(s, SDL_BLENDMODE_NONE);
+
+		SDL_Rect dest { x, 0, s->w, s->h };
+		SDL_BlitSurface(s, nullptr, out, &dest);
+
+		x += s->w;
+
+		SDL_FreeSurface(s);
+	}
+
+	atlas = textures.create(out, tt_glyphs);
+}
+
+value_box::~value_box()
+{
+	stop();
+}
+
+// lock must be held
+void value_box::publish(const render_state_t & new_state, const uint64_t arrival_us)
+{
+	total_w = new_state.w;
+	h       = new_state.h;
+
+	states.write_slot() = new_state;
+	states.write_slot().arrival_us = arrival_us;
+	states.publish();
+
+	// no longer seen by the renderer
+	states.write_slot().fallback.reset();
+
+	version++;
+
+	if (arrival_us)
+		changed();
+}
+
+std::pair<int, int> value_box::set_text(const std::vector<std::string> & in_, const uint64_t arrival_us)
+{
+	TRACE_SPAN("set_text");
+
+	uint64_t start_us = get_us();
+
+	std::vector<std::string> in;
+
+	std::string new_text;
+	uint32_t    new_tint = 0;
+	if (format_text(in_, &new_text, &in, &new_tint, false) == false) {
+		account_update(start_us);
+
+		return { total_w, h };
+	}
+
+	const std::string value = in.empty() ? "" : in.at(0);
+
+	render_state_t new_state { };
+	new_state.h    = glyph_h;
+	new_state.tint = new_tint;
+
+	bool is_number = value.size() <= max_chars;
+
+	for(size_t i=0; i<value.size() && is_number; i++) {
+		const char *p = strchr(glyph_chars, value[i]);
+
+		if (p == nullptr || value[i] == 0x00)
+			is_number = false;
+		else {
+			uint8_t idx = p - glyph_chars;
+
+			new_state.glyphs[new_state.n++] = idx;
+			new_state.w += glyph_advance[idx];
+		}
+	}
+
+	if (is_number)
+		new_state.w += unit_src.w;
+	else if (value.empty() == false) {
+		TRACE_SPAN("rasterize");
+
+		uint64_t raster_start_us = get_us();
+
+		new_state.n = 0;
+		new_state.w = 0;
+
+		trace_lock(font_lock, "wait font lock");
+		SDL_Surface *s = TTF_RenderUTF8_Blended(font, value.c_str(), white);
+		font_lock.unlock();
+
+		if (s) {
+			new_state.w        = s->w;
+			new_state.h        = s->h;
+			new_state.fallback = textures.create(s, tt_text);
+		}
+
+		raster_us += get_us() - raster_start_us;
+	}
+
+	trace_lock(lock, "wait container lock");
+
+	text = new_text;
+	tint = new_tint;
+	most_recent_update = time(nullptr);
+
+	publish(new_state, arrival_us);
+
+	lock.unlock();
+
+	account_update(start_us);
+
+	return { new_state.w, new_state.h };
+}
+
+std::pair<int, int> value_box::set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us)
+{
+	assert(0);
+
+	return { 0, 0 };
+}
+
+void value_box::clear()
+{
+	trace_lock(lock, "wait container lock");
+
+	text.clear();
+
+	publish({ }, 0);
+
+	lock.unlock();
+}
+
+int value_box::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
+{
+	int n_draw_calls = 0;
+
+	states.update();
+
+	const render_state_t & s = states.read_slot();
+
+	picked_up(s.arrival_us);
+
+	const int put_x = x * sd->xsteps + 1;
+	const int put_y = y * sd->ysteps + 1;
+	const int put_w = w * sd->xsteps - 2;
+	const int put_h = h * sd->ysteps - 2;
+
+	int cur_x = center_h ? put_x + put_w / 2 - s.w / 2 : put_x;
+	int cur_y = center_v ? put_y + (put_h - s.h) / 2 : put_y;
+	int end_x = put_x + put_w;
+
+	if (s.fallback) {
+		SDL_Texture *t = s.fallback->get(sd->screen);
+		if (!t)
+			return 0;
+
+		SDL_Rect src  { 0, 0, std::min(s.w, end_x - cur_x), s.h };
+		SDL_Rect dest { cur_x, cur_y, src.w, s.h };
+
+		apply_tint(t, s.tint);
+
+		SDL_RenderCopy(sd->screen, t, &src, &dest);
+
+		return 1;
+	}
+
+	SDL_Texture *atlas_t = atlas->get(sd->screen);
+	if (!atlas_t)
+		return 0;
+
+	apply_tint(atlas_t, s.tint);
+
+	for(size_t i=0; i<s.n; i++) {
+		const SDL_Rect & src = glyph_src[s.glyphs[i]];
+		const int advance    = glyph_advance[s.glyphs[i]];
+
+		if (cur_x + advance > end_x)
+			break;
+
+		// centered in its cell
+		SDL_Rect dest { cur_x + (advance - src.w) / 2, cur_y, src.w, src.h };
+
+		SDL_RenderCopy(sd->screen, atlas_t, &src, &dest);
+		n_draw_calls++;
+
+		cur_x += advance;
+	}
+
+	if (s.n && unit_src.w && cur_x + unit_src.w <= end_x) {
+		SDL_Rect dest { cur_x, cur_y, unit_src.w, unit_src.h };
+
+		SDL_RenderCopy(sd->screen, atlas_t, &unit_src, &dest);
+		n_draw_calls++;
+	}
+
+	return n_draw_calls;
+}
+
+int value_box::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
+{
+	assert(0);
+
+	return 0;
+}
+
+graph_box::graph_box(const int r, const int g, const int b, const int width, const size_t history, const bool area, const bool auto_scale, const double scale_lo, const double scale_hi, base_text_formatter *const fmt, const int clear_after) :
+	container("", 0, width, false, fmt, clear_after),
+	area(area), auto_scale(auto_scale), scale_lo(scale_lo), scale_hi(scale_hi),
+	values_per_bucket(std::max(size_t(1), (history + std::max(1, width) - 1) / std::max(1, width)))
+{
+	set_color(r, g, b);
+
+	buckets.resize(std::max(1, width));
+}
+
+graph_box::~graph_box()
+{
+	stop();
+}
+
+// lock must be held
+void graph_box::add_value(const float v)
+{
+	if (in_bucket >= values_per_bucket || n_filled == 0) {
+		if (n_filled)
+			head = (head + 1) % buckets.size();
+
+		buckets[head] = { v, v };
+		in_bucket     = 0;
+		n_filled      = std::min(n_filled + 1, buckets.size());
+	}
+	else {
+		buckets[head].lo = std::min(buckets[head].lo, v);
+		buckets[head].hi = std::max(buckets[head].hi, v);
+	}
+
+	in_bucket++;
+}
+
+// lock must be held
+void graph_box::publish_state(const uint64_t arrival_us)
+{
+	render_state_t & s = states.write_slot();
+
+	s.buckets.clear();
+	s.arrival_us = arrival_us;
+	s.lo = scale_lo;
+	s.hi = scale_hi;
+	s.tint = tint;
+
+	size_t first = (head + buckets.size() + 1 - n_filled) % buckets.size();
+
+	for(size_t i=0; i<n_filled; i++) {
+		const bucket_t & b = buckets[(first + i) % buckets.size()];
+
+		s.buckets.push_back(b);
+
+		if (auto_scale) {
+			s.lo = i ? std::min(s.lo, b.lo) : b.lo;
+			s.hi = i ? std::max(s.hi, b.hi) : b.hi;
+		}
+	}
+
+	states.publish();
+
+	version++;
+
+	if (arrival_us)
+		changed();
+}
+
+std::pair<int, int> graph_box::set_text(const std::vector<std::string> & in_, const uint64_t arrival_us)
+{
+	TRACE_SPAN("set_text");
+
+	uint64_t start_us = get_us();
+
+	std::vector<std::string> in;
+	std::string new_text;
+
+	uint32_t    new_tint = 0;
+
+	// the same value again is a new data point too
+	format_text(in_, &new_text, &in, &new_tint, true);
+
+	float value = 0.f;
+	bool  valid = false;
+
+	if (in.empty() == false) {
+		const std::string & line  = in.at(0);
+		const char         *start = line.data();
+		const char         *end   = line.data() + line.size();
+
+		while(start < end && isspace(*start))
+			start++;
+
+		valid = std::from_chars(start, end, value).ec == std::errc();
+	}
+
+	if (valid) {
+		trace_lock(lock, "wait container lock");
+
+		text = new_text;
+		tint = new_tint;
+		most_recent_update = time(nullptr);
+
+		add_value(value);
+
+		publish_state(arrival_us);
+
+		lock.unlock();
+	}
+
+	account_update(start_us);
+
+	return { max_width, 0 };
+}
+
+std::pair<int, int> graph_box::set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us)
+{
+	assert(0);
+
+	return { 0, 0 };
+}
+
+void graph_box::clear()
+{
+	trace_lock(lock, "wait container lock");
+
+	text.clear();
+	head      = 0;
+	n_filled  = 0;
+	in_bucket = 0;
+
+	publish_state(0);
+
+	lock.unlock();
+}
+
+int graph_box::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
+{
+	const int put_x = x * sd->xsteps + 1;
+	const int put_y = y * sd->ysteps + 1;
+	const int put_w = w * sd->xsteps - 2;
+	const int put_h = h * sd->ysteps - 2;
+
+	const SDL_Rect box { put_x, put_y, put_w, put_h };
+
+	bool updated = states.update();
+
+	picked_up(states.read_slot().arrival_us);
+
+	if (updated || box.x != drawn_box.x || box.y != drawn_box.y || box.w != drawn_box.w || box.h != drawn_box.h) {
+		const render_state_t & s = states.read_slot();
+
+		drawn_box = box;
+
+		points.clear();
+		rects.clear();
+
+		const float range  = s.hi - s.lo;
+		const int   bottom = put_y + put_h - 1;
+		// newest value at the right
+		const int   left   = put_x + std::max(0, put_w - int(s.buckets.size()));
+		const size_t skip  = s.buckets.size() > size_t(put_w) ? s.buckets.size() - put_w : 0;
+
+		auto to_y = [&](const float v) {
+			if (range <= 0.f)
+				return put_y + put_h / 2;
+
+			float f = std::min(1.f, std::max(0.f, (v - s.lo) / range));
+
+			return bottom - int(f * (put_h - 1));
+		};
+
+		for(size_t i=skip; i<s.buckets.size(); i++) {
+			const int cx   = left + int(i - skip);
+			const int y_hi = to_y(s.buckets[i].hi);
+
+			if (area)
+				rects.push_back({ cx, y_hi, 1, bottom - y_hi + 1 });
+			else {
+				points.push_back({ cx, y_hi });
+				points.push_back({ cx, to_y(s.buckets[i].lo) });
+			}
+		}
+	}
+
+	SDL_Color c = get_tint(states.read_slot().tint);
+	SDL_SetRenderDrawColor(sd->screen, c.r, c.g, c.b, 255);
+
+	if (area && rects.empty() == false) {
+		SDL_RenderFillRects(sd->screen, rects.data(), rects.size());
+		return 1;
+	}
+
+	if (points.size() >= 2) {
+		SDL_RenderDrawLines(sd->screen, points.data(), points.size());
+		return 1;
+	}
+
+	return 0;
+}
+
+int graph_box::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
+{
+	assert(0);
+
+	return 0;
+}
+
+log_box::log_box(const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, const int max_height, base_text_formatter *const fmt, const int clear_after) :
+	container(font_file, font_height, max_width, false, fmt, clear_after)
+{
+	set_color(r, g, b);
+
+	trace_lock(font_lock, "wait font lock");
+	line_h = std::max(1, TTF_FontLineSkip(font));
+	font_lock.unlock();
+
+	max_lines = std::max(1, max_height / line_h);
+
+	ring.resize(max_lines);
+
+	for(int i=0; i<3; i++)
+		states.get(i).ring.resize(max_lines);
+}
+
+log_box::~log_box()
+{
+	stop();
+}
+
+// lock must be held
+void log_box::publish_state(const uint64_t arrival_us)
+{
+	render_state_t & s = states.write_slot();
+
+	// lines go in one after the other, so what this slot misses are the
+	// newest ones
+	uint64_t n_new  = std::min(uint64_t(max_lines), n_written - s.n_written);
+	size_t   newest = (head + n_lines + max_lines - 1) % max_lines;
+
+	for(uint64_t i=0; i<n_new; i++) {
+		size_t nr = (newest + max_lines - i) % max_lines;
+
+		s.ring[nr] = ring[nr];
+	}
+
+	s.head       = head;
+	s.n_lines    = n_lines;
+	s.n_written  = n_written;
+	s.arrival_us = arrival_us;
+
+	states.publish();
+
+	version++;
+
+	if (arrival_us)
+		changed();
+}
+
+std::pair<int, int> log_box::set_text(const std::vector<std::string> & in_, const uint64_t arrival_us)
+{
+	TRACE_SPAN("set_text");
+
+	uint64_t start_us = get_us();
+
+	std::vector<std::string> in;
+	std::string new_text;
+
+	uint32_t    new_tint = 0;
+
+	// a repeated line is still a new line
+	format_text(in_, &new_text, &in, &new_tint, true);
+
+	// only the lines that will be visible
+	size_t first = in.size() > max_lines ? in.size() - max_lines : 0;
+
+	std::vector<line_t> new_lines;
+
+	uint64_t raster_start_us = get_us();
+
+	for(size_t i=first; i<in.size(); i++) {
+		line_t line { { }, 0, line_h, new_tint };
+
+		if (in[i].empty() == false) {
+			TRACE_SPAN("rasterize");
+
+			trace_lock(font_lock, "wait font lock");
+			SDL_Surface *s = TTF_RenderUTF8_Blended(font, in[i].c_str(), white);
+			font_lock.unlock();
+
+			if (s) {
+				line.w = s->w;
+				line.h = s->h;
+				line.t = textures.create(s, tt_text);
+			}
+		}
+
+		new_lines.push_back(line);
+	}
+
+	raster_us += get_us() - raster_start_us;
+
+	trace_lock(lock, "wait container lock");
+
+	for(auto & line : new_lines) {
+		if (n_lines == max_lines) {
+			ring[head] = line;  // replaces the oldest
+			head = (head + 1) % max_lines;
+		}
+		else {
+			ring[(head + n_lines) % max_lines] = line;
+			n_lines++;
+		}
+
+		n_written++;
+	}
+
+	text = new_text;
+	tint = new_tint;
+	most_recent_update = time(nullptr);
+
+	publish_state(arrival_us);
+
+	lock.unlock();
+
+	account_update(start_us);
+
+	return { max_width, int(n_lines) * line_h };
+}
+
+std::pair<int, int> log_box::set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us)
+{
+	assert(0);
+
+	return { 0, 0 };
+}
+
+void log_box::clear()
+{
+	trace_lock(lock, "wait container lock");
+
+	text.clear();
+
+	for(auto & line : ring)
+		line = { { }, 0, 0, 0 };
+
+	head    = 0;
+	n_lines = 0;
+
+	// all of the ring changed: every slot copies all of it
+	n_written += max_lines;
+
+	publish_state(0);
+
+	lock.unlock();
+}
+
+int log_box::put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v)
+{
+	int n_draw_calls = 0;
+
+	states.update();
+
+	const render_state_t & s = states.read_slot();
+
+	picked_up(s.arrival_us);
+
+	const int put_x = x * sd->xsteps + 1;
+	const int put_y = y * sd->ysteps + 1;
+	const int put_w = w * sd->xsteps - 2;
+	const int put_h = h * sd->ysteps - 2;
+
+	// newest line at the bottom
+	int cur_y = put_y + put_h - int(s.n_lines) * line_h;
+
+	for(size_t i=0; i<s.n_lines; i++) {
+		auto & line = s.ring[(s.head + i) % max_lines];
+
+		SDL_Texture *t = line.t && cur_y >= put_y ? line.t->get(sd->screen) : nullptr;
+
+		if (t) {
+			SDL_Rect src  { 0, 0, std::min(line.w, put_w), line.h };
+			SDL_Rect dest { put_x, cur_y, src.w, line.h };
+
+			apply_tint(t, line.tint);
+
+			SDL_RenderCopy(sd->screen, t, &src, &dest);
+			n_draw_calls++;
+		}
+
+		cur_y += line_h;
+	}
+
+	return n_draw_calls;
+}
+
+int log_box::put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h)
+{
+	assert(0);
+
+	return 0;
 }
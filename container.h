@@ -1,4 +1,8 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -10,8 +14,31 @@
 #include <SDL2/SDL_ttf.h>
 
 #include "formatters.h"
+#include "text_layout.h"
+#include "texture_budget.h"
+#include "texture_cache.h"
+#include "triple_buffer.h"
 
 
+// upper bounds of the update-to-present latency histogram
+constexpr const uint64_t latency_bucket_us[] = { 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000 };
+constexpr const size_t   n_latency_buckets   = sizeof(latency_bucket_us) / sizeof(latency_bucket_us[0]);
+
+typedef struct
+{
+	uint64_t n_updates;    // set_text/set_pixels invocations
+	uint64_t n_unchanged;  // part of n_updates that did not change the text
+	uint64_t update_us;    // time spent in them
+	uint64_t format_us;    // part of update_us spent in the formatter
+	uint64_t raster_us;    // time spent rasterizing (also outside of set_text)
+	uint64_t n_latency;    // number of updates that were presented
+	uint64_t latency_us;   // sum of arrival to SDL_RenderPresent times
+	uint64_t latency_hist[n_latency_buckets];  // per bucket, excluding the ones above the last
+	texture_cache_stats_t cache;  // all zero without a cache
+	uint64_t texture_bytes[n_texture_types];
+	time_t   last_update;
+} container_timings_t;
+
 typedef struct
 {
 	SDL_Renderer *screen;
@@ -19,64 +46,402 @@ typedef struct
 	int xsteps, ysteps;
 } screen_descriptor_t;
 
-class container
+// replaces the fg-color when the (first) value in the text crosses a threshold
+typedef struct
 {
-private:
-	TTF_Font *font { nullptr };
+	bool      above;      // else below
+	double    threshold;
+	SDL_Color col;
+} color_rule_t;
 
+// Each concrete container hands what it shows to the renderer through a
+// triple_buffer of its own render_state_t: producers (feeds, the container's
+// own threads) publish with 'lock' held, the renderer reads the newest
+// state without ever locking.
+class container
+{
 protected:
-	SDL_Renderer   *renderer       { nullptr    };
+	TTF_Font       *font           { nullptr    };
+	text_layout    *layout         { nullptr    };
+	// font and layout are private to this container: rasterizing in other
+	// containers can go on in parallel. ttf_lock is only for opening and
+	// closing fonts.
+	std::mutex      font_lock;
 	const int       max_width      { 0          };
 	std::mutex      lock;
-	std::vector<SDL_Texture *> surfaces;
 	std::string     text;
 	int             total_w        { 0          };
 	int             h              { 0          };
 	SDL_Color       col            { 0, 0, 0, 0 };
+	// text is rasterized in white and colored when drawn: a different
+	// color does not need the text to be rasterized again. The color goes
+	// in the render state, with the content it belongs to. Textures stay
+	// 32 bit (SDL has no alpha-only texture format), so this saves work,
+	// not memory.
+	std::vector<color_rule_t> color_rules;
+	uint32_t        tint           { 0          };  // 0xrrggbb of 'text', lock must be held
 	base_text_formatter *const fmt { nullptr    };
 	const int       clear_after    { -1         };
 	time_t          most_recent_update { 0      };
-	std::thread    *th             { nullptr    };
+	std::thread    *th             { nullptr    };  // clear-after
+	texture_cache  *cache          { nullptr    };
+
+	// set when the container is being destroyed
+	std::atomic_bool        stop_flag { false };
+	std::mutex              stop_lock;
+	std::condition_variable stop_cv;
+	texture_account textures;
+
+	// incremented each time what is shown changes
+	std::atomic_uint64_t version   { 0          };
+
+	std::atomic_uint64_t n_updates   { 0        };
+	std::atomic_uint64_t n_unchanged { 0        };
+	std::atomic_uint64_t update_us   { 0        };
+	std::atomic_uint64_t format_us   { 0        };
+	std::atomic_uint64_t raster_us   { 0        };
+	std::atomic_uint64_t n_latency   { 0        };
+	std::atomic_uint64_t latency_us  { 0        };
+	std::atomic_uint64_t latency_hist[n_latency_buckets] { };
+	std::atomic<time_t>  last_update { 0        };
+
+	// renderer only: arrival time of the content in the most recently
+	// picked up render state and of the one that was not presented yet
+	uint64_t        picked_arrival_us  { 0 };
+	uint64_t        pending_arrival_us { 0 };
+
+	void      set_color(const int r, const int g, const int b);
+	static SDL_Color get_tint (const uint32_t tint);
+	static void      apply_tint(SDL_Texture *const t, const uint32_t tint);
+
+	// to be invoked first by the destructor of each concrete container:
+	// the clear-after thread invokes the virtual clear() and must be gone
+	// before the derived parts are destroyed
+	void stop();
+	bool stopping() const;
+
+	void account_update(const uint64_t start_us);
+	void changed();
+	// by the renderer, with the arrival_us of the state it draws
+	void picked_up(const uint64_t arrival_us);
+
+	// false when the text did not change; with repeats_are_new (a log, a
+	// graph) the same text again is an update too. new_tint is the color
+	// of new_text, to be published with it.
+	bool format_text(const std::vector<std::string> & in_, std::string *const new_text, std::vector<std::string> *const lines, uint32_t *const new_tint, const bool repeats_are_new);
 
 public:
-	container(SDL_Renderer *const renderer, const std::string & font_file, const int font_height, const int max_width, base_text_formatter *const fmt, const int clear_after);
+	// without font_file (a graph) there is no font and no layout
+	container(const std::string & font_file, const int font_height, const int max_width, const bool word_wrap, base_text_formatter *const fmt, const int clear_after);
 	virtual ~container();
 
 	void operator()();
 
-	virtual std::pair<int, int> set_text  (const std::vector<std::string> & in_);
-	virtual std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height);
+	// arrival_us: get_us() timestamp of when the data was received by the feed
+	virtual std::pair<int, int> set_text  (const std::vector<std::string> & in_, const uint64_t arrival_us) = 0;
+	virtual std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) = 0;
+
+	virtual void clear() = 0;
 
-	virtual void put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v) = 0;
+	// only before feeds are started
+	void set_color_rules(const std::vector<color_rule_t> & rules);
 
-	virtual void put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h) = 0;
+	uint64_t get_version() const;
+
+	container_timings_t get_timings() const;
+
+	// to be invoked after each SDL_RenderPresent
+	void presented(const uint64_t now_us);
+
+	// these return the number of draw calls issued
+	virtual int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v) = 0;
+
+	virtual int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h) = 0;
 };
 
 class text_box : public container
 {
+private:
+	const bool   center_h      { false   };
+	const int    page_interval { -1      };
+	int          lines_per_page { 1      };
+
+	// wrapped lines, at most one page is rasterized at a time
+	std::vector<std::string> lines;
+	size_t       page       { 0       };
+	uint64_t     generation { 0       };
+
+	// all lines of the page composed into one texture
+	typedef struct {
+		std::shared_ptr<texture> t;  // can also be in the cache
+		int          w, h;
+		int          line_h;
+		bool         is_text;  // else pixels: not tinted
+		uint32_t     tint;
+		uint64_t     arrival_us;
+	} render_state_t;
+
+	triple_buffer<render_state_t> states;
+
+	// renderer only
+	bool         dest_valid { false   };
+	SDL_Rect     src        { 0, 0, 0, 0 };
+	SDL_Rect     dest       { 0, 0, 0, 0 };
+
+	std::thread *th         { nullptr };
+
+	std::shared_ptr<texture> compose(const std::vector<SDL_Surface *> & lines, const int w, const int h);
+	void swap_texture(const std::shared_ptr<texture> & new_t, const int new_w, const int new_h, const int new_line_h, const bool is_text, const uint64_t gen, const uint64_t arrival_us);
+	std::vector<std::string> get_page(const size_t nr) const;
+	std::pair<int, int> render_page(const std::vector<std::string> & page_lines, const uint64_t gen, const uint64_t arrival_us);
+
 public:
-	text_box(SDL_Renderer * const renderer, const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, base_text_formatter *const fmt, const int clear_after);
+	text_box(const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, const int max_height, const bool word_wrap, const bool center_h, base_text_formatter *const fmt, const int clear_after, const int page_interval, const size_t cache_entries);
 	virtual ~text_box();
 
-	void put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h);
-	void put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v);
+	std::pair<int, int> set_text  (const std::vector<std::string> & in_, const uint64_t arrival_us) override;
+	std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) override;
+
+	void clear() override;
+
+	int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h);
+	int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v);
+
+	void operator()();
 };
 
 class scroller : public container
 {
 private:
+	typedef struct {
+		std::string  text;
+		int          x;  // sum of the widths of all segments before this one
+		int          w;
+		int          h;
+		std::shared_ptr<texture> t;  // empty when not in view
+		uint32_t     tint;  // in append mode each message has its own color
+		uint64_t     arrival_us;
+	} segment_t;
+
+	std::vector<segment_t> segments;
+	std::vector<size_t>    resident;
+	size_t   cur_segment  { 0     };
+	uint64_t generation   { 0     };
+
+	// set by the renderer
+	std::atomic_int visible_w { 0 };
+
+	// the visible parts of the segments at the current scroll position
+	typedef struct {
+		std::shared_ptr<texture> t;
+		int src_x;
+		int x;  // relative to the left of the box
+		int w;
+		uint32_t tint;
+	} piece_t;
+
+	typedef struct {
+		std::vector<piece_t> pieces;
+		int h;
+		uint64_t arrival_us;
+	} render_state_t;
+
+	// textures stay alive as long as a slot refers to them
+	triple_buffer<render_state_t> states;
+
+	// newest content that was completely rasterized when in view
+	uint64_t shown_arrival_us { 0 };
+
 	int  render_x     { 0     };
 	int  scroll_speed { 1     };
 	bool center_v     { false };
 
+	// append mode: messages are queued behind each other instead of
+	// replacing the text, and dropped when they scrolled out of view
+	const bool        append      { false };
+	const std::string separator;
+	const size_t      max_queue   { 256   };  // in segments
+	uint64_t          n_dropped   { 0     };
+
 	std::thread *th { nullptr };
 
+	void advance_cursor();
+	void drop_scrolled();
+	void rasterize_window();
+	void publish_state();
+
 public:
-	scroller(SDL_Renderer * const renderer, const std::string & font_file, const int scroll_speed, const int font_height, const int r, const int g, const int b, const int max_width, base_text_formatter *const fmt, const int clear_after, const bool center_v);
+	scroller(const std::string & font_file, const int scroll_speed, const int font_height, const int r, const int g, const int b, const int max_width, base_text_formatter *const fmt, const int clear_after, const bool center_v, const bool append, const std::string & separator, const size_t max_queue);
 	virtual ~scroller();
 
-	void put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v);
-	void put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h);
+	std::pair<int, int> set_text  (const std::vector<std::string> & in_, const uint64_t arrival_us) override;
+	std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) override;
+
+	void clear() override;
+
+	int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v);
+	int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h);
 
 	void operator()();
 };
+
+// Shows a single number. The characters of numbers and the unit are
+// rasterized once; updates only pick glyphs, so a changing value never
+// touches FreeType. Digits all get the width of the widest one: the layout
+// does not jitter when the value changes.
+// Anything that is not a number is rasterized as a whole.
+class value_box : public container
+{
+private:
+	static constexpr const char glyph_chars[] = "0123456789.-,";
+	static constexpr const size_t n_glyphs  = sizeof(glyph_chars) - 1;
+	static constexpr const size_t max_chars = 32;
+
+	const bool   center_h   { false   };
+
+	// glyphs and unit side by side in one texture
+	std::shared_ptr<texture> atlas;
+	SDL_Rect     glyph_src[n_glyphs] { };
+	int          glyph_advance[n_glyphs] { };
+	SDL_Rect     unit_src   { 0, 0, 0, 0 };
+	int          glyph_h    { 0       };
+
+	typedef struct {
+		uint8_t      glyphs[max_chars];  // indexes in glyph_chars
+		size_t       n;
+		std::shared_ptr<texture> fallback;  // when the text is not a number
+		int          w, h;
+		uint32_t     tint;
+		uint64_t     arrival_us;
+	} render_state_t;
+
+	triple_buffer<render_state_t> states;
+
+	void publish(const render_state_t & new_state, const uint64_t arrival_us);
+
+public:
+	value_box(const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, const bool center_h, const std::string & unit, base_text_formatter *const fmt, const int clear_after);
+	virtual ~value_box();
+
+	std::pair<int, int> set_text  (const std::vector<std::string> & in_, const uint64_t arrival_us) override;
+	std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) override;
+
+	void clear() override;
+
+	int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v) override;
+	int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h) override;
+};
+
+// History of a numeric value as a line or area chart. Values are reduced
+// to min/max per pixel column while they come in, so drawing depends on
+// the width of the box and not on the length of the history.
+class graph_box : public container
+{
+private:
+	typedef struct {
+		float lo, hi;
+	} bucket_t;
+
+	const bool   area              { false };
+	const bool   auto_scale        { true  };
+	const float  scale_lo          { 0.f   };
+	const float  scale_hi          { 1.f   };
+	const size_t values_per_bucket { 1     };
+
+	// one per pixel column, a ring
+	std::vector<bucket_t> buckets;
+	size_t       head      { 0 };  // bucket being filled
+	size_t       n_filled  { 0 };
+	size_t       in_bucket { 0 };  // values in the head bucket
+
+	typedef struct {
+		std::vector<bucket_t> buckets;  // oldest first
+		float lo, hi;
+		uint32_t tint;
+		uint64_t arrival_us;
+	} render_state_t;
+
+	triple_buffer<render_state_t> states;
+
+	// renderer only: rebuilt when the state changes
+	std::vector<SDL_Point> points;
+	std::vector<SDL_Rect>  rects;
+	SDL_Rect               drawn_box { 0, 0, 0, 0 };
+
+	void add_value(const float v);
+	void publish_state(const uint64_t arrival_us);
+
+public:
+	// history: number of values to show in width pixels
+	graph_box(const int r, const int g, const int b, const int width, const size_t history, const bool area, const bool auto_scale, const double scale_lo, const double scale_hi, base_text_formatter *const fmt, const int clear_after);
+	virtual ~graph_box();
+
+	std::pair<int, int> set_text  (const std::vector<std::string> & in_, const uint64_t arrival_us) override;
+	std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) override;
+
+	void clear() override;
+
+	int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v) override;
+	int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h) override;
+};
+
+// The last lines of e.g. a tail feed. Every line is rasterized once, when
+// it comes in; the oldest one is dropped when the box is full.
+class log_box : public container
+{
+private:
+	typedef struct {
+		std::shared_ptr<texture> t;  // empty for an empty line
+		int w, h;
+		uint32_t tint;  // each line keeps the color it came in with
+	} line_t;
+
+	size_t       max_lines  { 1 };
+	int          line_h     { 0 };
+
+	// a ring of the visible lines
+	std::vector<line_t> ring;
+	size_t       head       { 0 };  // oldest line
+	size_t       n_lines    { 0 };
+	uint64_t     n_written  { 0 };  // lines put in the ring
+
+	// a copy of the ring; publishing only copies the lines written since
+	// the slot was last published
+	typedef struct {
+		std::vector<line_t> ring;
+		size_t   head;
+		size_t   n_lines;
+		uint64_t n_written;
+		uint64_t arrival_us;
+	} render_state_t;
+
+	triple_buffer<render_state_t> states;
+
+	void publish_state(const uint64_t arrival_us);
+
+public:
+	log_box(const std::string & font_file, const int font_height, const int r, const int g, const int b, const int max_width, const int max_height, base_text_formatter *const fmt, const int clear_after);
+	virtual ~log_box();
+
+	std::pair<int, int> set_text  (const std::vector<std::string> & in_, const uint64_t arrival_us) override;
+	std::pair<int, int> set_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us) override;
+
+	void clear() override;
+
+	int put_static(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool center_h, const bool center_v) override;
+	int put_scroller(screen_descriptor_t *const sd, const int x, const int y, const int put_w, const int put_h) override;
+};
+
+typedef enum { ct_static, ct_scroller } container_type_t;
+
+typedef struct {
+	container *c;
+	container_type_t ct;
+	int font_r, font_g, font_b;
+	int bg_r, bg_g, bg_b;
+	int b_r, b_g, b_b;
+	int x, y, w, h;
+	bool border, center_h, center_v, bg_fill;
+	bool baked;  // content never changes: part of the background layer
+	std::string name;
+} container_t;
@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -5,6 +6,8 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "error.h"
+
 
 [[ noreturn ]] void error_exit(const bool se, const char *format, ...)
 {
@@ -28,3 +31,15 @@
 
 	exit(EXIT_FAILURE);
 }
+
+void report_nth(const uint64_t n, const char *format, ...)
+{
+	if (n == 0 || (n & (n - 1)) != 0)
+		return;
+
+	va_list ap;
+
+	va_start(ap, format);
+	vprintf(format, ap);
+	va_end(ap);
+}
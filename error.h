@@ -1 +1,9 @@
+#pragma once
+#include <cstdint>
+
+
 [[ noreturn ]] void error_exit(const bool se, const char *format, ...);
+
+// for the n-th occurrence of a recurring problem: only prints for the 1st,
+// 2nd, 4th, 8th, ... one so that the console is not flooded
+void report_nth(const uint64_t n, const char *format, ...);
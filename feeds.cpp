@@ -12,7 +12,10 @@
 #include "error.h"
 #include "feeds.h"
 #include "proc.h"
+#include "record.h"
 #include "str.h"
+#include "timing.h"
+#include "trace.h"
 
 
 extern std::atomic_bool do_exit;
@@ -21,12 +24,14 @@ extern void set_thread_name(const std::string & name);
 
 void on_message(struct mosquitto *, void *arg, const struct mosquitto_message *msg, const mosquitto_property *)
 {
-	container *c = (container *)arg;
+	uint64_t arrival_us = get_us();
+
+	feed *f = (feed *)arg;
 
 	std::string new_text((const char *)msg->payload, msg->payloadlen);
 
-	auto result = c->set_text({ new_text });
-	printf("on_message: %s (%dx%d)\n", new_text.c_str(), result.first, result.second);
+	f->publish({ new_text }, arrival_us, msg->topic);
+	printf("on_message: %s\n", new_text.c_str());
 }
 
 feed::feed(container *const c) : c(c)
@@ -37,6 +42,39 @@ feed::~feed()
 {
 }
 
+void feed::set_recorder(recorder *const r, const uint32_t instance)
+{
+	rec_instance = instance;
+	rec          = r;
+}
+
+void feed::publish(const std::vector<std::string> & text, const uint64_t arrival_us, const std::string & source)
+{
+	TRACE_SPAN("feed receive");
+
+	n_received++;
+
+	recorder *r = rec;
+	if (r)
+		r->record(rec_instance, arrival_us, source, text);
+
+	c->set_text(text, arrival_us);
+}
+
+void feed::publish_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us)
+{
+	TRACE_SPAN("feed receive");
+
+	n_received++;
+
+	c->set_pixels(rgb_pixels, width, height, arrival_us);
+}
+
+uint64_t feed::get_n_received() const
+{
+	return n_received;
+}
+
 static_feed::static_feed(const std::string & text, container *const c) : feed(c), text(split(text, "\n"))
 {
 	assert(c);
@@ -50,19 +88,23 @@ static_feed::~static_feed()
 	delete th;
 }
 
+void static_feed::set_recorder(recorder *const r, const uint32_t instance)
+{
+}
+
 void static_feed::operator()()
 {
 	set_thread_name("static");
 
 	while(!do_exit) {
-		c->set_text(text);
+		publish(text, get_us());
 		usleep(500000);
 	}
 }
 
 mqtt_feed::mqtt_feed(const std::string & host, const int port, const std::vector<std::string> & topics, container *const c) : feed(c)
 {
-	mi = mosquitto_new(nullptr, true, c);
+	mi = mosquitto_new(nullptr, true, static_cast<feed *>(this));
 	if (!mi)
 		error_exit(false, "Cannot crate mosquitto instance");
 
@@ -118,6 +160,7 @@ void exec_feed::operator()()
 		auto rc = exec_with_pipe(cmd, ".", 80, 25, -1, true, true);
 		char buffer[65536] { 0 };
 		int n_chars = read(std::get<1>(rc), buffer, sizeof(buffer) - 1);
+		uint64_t arrival_us = get_us();
 		close(std::get<1>(rc));
 
 		kill(SIGTERM, std::get<0>(rc));
@@ -140,7 +183,7 @@ void exec_feed::operator()()
 		}
 
 		std::vector<std::string> parts = split(buffer, "\n");
-		c->set_text(parts);
+		publish(parts, arrival_us, cmd);
 
 		usleep(interval_ms * 1000);
 	}
@@ -174,7 +217,7 @@ void tail_feed::operator()()
 			continue;
 
 		if (chr == 10) {
-			c->set_text({ buffer });
+			publish({ buffer }, get_us(), cmd);
 
 			buffer.clear();
 		}
@@ -187,3 +230,15 @@ void tail_feed::operator()()
 
 	kill(SIGTERM, std::get<0>(rc));
 }
+
+replay_feed::replay_feed(container *const c) : feed(c)
+{
+}
+
+replay_feed::~replay_feed()
+{
+}
+
+void replay_feed::operator()()
+{
+}
@@ -1,27 +1,52 @@
+#pragma once
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <condition_variable>
 #include <cstring>
 #include <mosquitto.h>
 #include <csignal>
+#include <map>
+#include <mutex>
+#include <random>
 #include <string>
 #include <thread>
 #include <unistd.h>
 #include <vector>
+#include <sys/stat.h>
 
 #include "container.h"
 #include "proc.h"
 #include "str.h"
+#include "time_zone.h"
 
 
+class recorder;
+
 class feed
 {
 protected:
 	std::thread *th       { nullptr };
 	container    *const c { nullptr };
 
+	std::atomic_uint64_t n_received { 0 };
+
+	std::atomic<recorder *> rec  { nullptr };
+	uint32_t     rec_instance     { 0       };
+
 public:
 	feed(container *const c);
 	virtual ~feed();
 
+	// log everything that is published from now on
+	virtual void set_recorder(recorder *const r, const uint32_t instance);
+
+	// hand received data to the container; source is e.g. the mqtt topic
+	void publish       (const std::vector<std::string> & text, const uint64_t arrival_us, const std::string & source = "");
+	void publish_pixels(const uint8_t *const rgb_pixels, const int width, const int height, const uint64_t arrival_us);
+
+	uint64_t get_n_received() const;
+
 	virtual void operator()() = 0;
 };
 
@@ -34,6 +59,9 @@ public:
 	static_feed(const std::string & text, container *const c);
 	virtual ~static_feed();
 
+	// not recorded: a replay keeps static feeds, and they republish twice a second
+	void set_recorder(recorder *const r, const uint32_t instance) override;
+
 	void operator()() override;
 };
 
@@ -85,3 +113,159 @@ public:
 
 	void operator()() override;
 };
+
+// the current time, formatted with strftime; updated on second boundaries
+// but only published when the text changes
+class clock_feed : public feed
+{
+private:
+	const std::string format;
+	time_zone        *tz { nullptr };  // nullptr for local time
+
+public:
+	// timezone is a tzdata name or a POSIX TZ string, empty for local time
+	clock_feed(const std::string & format, const std::string & timezone, container *const c);
+	virtual ~clock_feed();
+
+	void operator()() override;
+};
+
+// the contents of a file, read again each time it is written or replaced
+class file_feed : public feed
+{
+private:
+	const std::string path;
+	std::string       dir;
+	std::string       name;
+	int               fd { -1 };  // inotify
+	std::string       buffer;
+	bool              shown { false };  // the box shows the file
+
+	bool read_file();
+	void push();
+
+public:
+	file_feed(const std::string & path, container *const c);
+	virtual ~file_feed();
+
+	void operator()() override;
+};
+
+// Receives datagrams ("key\npayload") on a unix domain socket and hands
+// them to the socket_feed with that key. One per path, shared by all
+// socket feeds on it.
+class socket_listener
+{
+private:
+	const std::string path;
+	int               fd      { -1      };
+	dev_t             dev     { 0       };  // of the socket file this
+	ino_t             ino     { 0       };  // process created
+	char             *buffers { nullptr };
+	std::thread      *th      { nullptr };
+	std::atomic_bool  stop_flag { false };  // the last feed is gone
+
+	std::mutex        lock;
+	std::map<std::string, feed *> feeds;
+	// publishing is done without the lock: remove() waits for it
+	feed             *publishing { nullptr };
+	std::condition_variable publish_done;
+
+	size_t            n_users   { 0 };  // protected by listeners_lock
+	uint64_t          n_invalid { 0 };
+
+	void report_invalid();
+	void route(const char *const msg, const size_t len, const uint64_t arrival_us);
+
+	socket_listener(const std::string & path);
+	virtual ~socket_listener();
+
+public:
+	static socket_listener *get    (const std::string & path);
+	static void             release(socket_listener *const l);
+
+	void add   (const std::string & key, feed *const f);
+	void remove(const std::string & key);
+
+	void operator()();
+};
+
+// data is pushed by local processes through a socket_listener
+class socket_feed : public feed
+{
+private:
+	const std::string key;
+	socket_listener  *listener { nullptr };
+
+public:
+	socket_feed(const std::string & path, const std::string & key, container *const c);
+	virtual ~socket_feed();
+
+	void operator()() override;
+};
+
+// load, memory, cpu, network and temperature as a json object, read from
+// /proc and /sys through descriptors that stay open
+class sysstat_feed : public feed
+{
+private:
+	const int         interval_ms;
+	const std::string interface;  // empty: all but lo
+
+	int  fd_loadavg { -1 };
+	int  fd_meminfo { -1 };
+	int  fd_stat    { -1 };
+	int  fd_net     { -1 };
+	int  fd_thermal { -1 };
+
+	char buffer[65536] { 0 };
+
+	bool read_file(const int fd);
+	void read_cpu (uint64_t *const busy, uint64_t *const total);
+	void read_net (uint64_t *const rx, uint64_t *const tx);
+
+public:
+	sysstat_feed(const int interval_ms, const std::string & interface, const int thermal_zone, container *const c);
+	virtual ~sysstat_feed();
+
+	void operator()() override;
+};
+
+typedef enum { sm_numbers, sm_json, sm_ticker } synthetic_mode_t;
+
+// generates messages at a given rate, for stress testing
+class synthetic_feed : public feed
+{
+private:
+	const synthetic_mode_t mode;
+	const std::string json_template;
+	const size_t      size;
+	const double      min_value;
+	const double      max_value;
+	double            rate;           // messages per second
+	const double      ramp_step;      // added to rate every ramp_interval seconds
+	const int         ramp_interval;
+	std::mt19937_64   rng;
+	uint64_t          seq { 0 };
+
+	double      random_value(const double mi, const double ma);
+	std::string random_word();
+	std::string expand(const std::string & cmd);
+	std::vector<std::string> generate();
+
+public:
+	synthetic_feed(const synthetic_mode_t mode, const std::string & json_template, const size_t size, const double min_value, const double max_value, const double rate, const double ramp_step, const int ramp_interval, const uint64_t seed, container *const c);
+	virtual ~synthetic_feed();
+
+	void operator()() override;
+};
+
+// data is injected by a replayer
+class replay_feed : public feed
+{
+public:
+	replay_feed(container *const c);
+	virtual ~replay_feed();
+
+	void operator()() override;
+};
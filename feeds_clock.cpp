@@ -0,0 +1,71 @@
+#include <cerrno>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "feeds.h"
+#include "str.h"
+#include "timing.h"
+
+
+extern std::atomic_bool do_exit;
+
+static std::string format_time(const time_t t, const std::string & format, const time_zone *const tz)
+{
+	struct tm tm { };
+	char      buffer[256] { 0 };
+
+	// TZ is process wide and inherited by exec'd children: it is not changed
+	if (tz)
+		tz->to_tm(t, &tm);
+	else
+		localtime_r(&t, &tm);
+
+	size_t n = strftime(buffer, sizeof buffer, format.c_str(), &tm);
+
+	return std::string(buffer, n);
+}
+
+clock_feed::clock_feed(const std::string & format, const std::string & timezone, container *const c) :
+	feed(c), format(format)
+{
+	if (timezone.empty() == false)
+		tz = new time_zone(timezone);
+
+	th = new std::thread(std::ref(*this));
+}
+
+clock_feed::~clock_feed()
+{
+	th->join();
+	delete th;
+
+	delete tz;
+}
+
+void clock_feed::operator()()
+{
+	set_thread_name("clock");
+
+	std::string prev;
+
+	while(!do_exit) {
+		struct timespec now { };
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		// a format without seconds only changes at minute boundaries
+		std::string text = format_time(now.tv_sec, format, tz);
+
+		if (text != prev) {
+			publish(split(text, "\n"), get_us());
+
+			prev = text;
+		}
+
+		// wake up exactly on the next second boundary instead of drifting
+		struct timespec next { now.tv_sec + 1, 0 };
+
+		while(clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &next, nullptr) == EINTR && !do_exit) {
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <sys/inotify.h>
+
+#include "error.h"
+#include "feeds.h"
+#include "str.h"
+#include "timing.h"
+
+
+extern std::atomic_bool do_exit;
+
+file_feed::file_feed(const std::string & path, container *const c) : feed(c), path(path)
+{
+	size_t slash = path.rfind('/');
+
+	if (slash == std::string::npos) {
+		dir  = ".";
+		name = path;
+	}
+	else {
+		dir  = slash == 0 ? "/" : path.substr(0, slash);
+		name = path.substr(slash + 1);
+	}
+
+	if (name.empty())
+		error_exit(false, "file feed: \"%s\" is not a file", path.c_str());
+
+	fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (fd == -1)
+		error_exit(true, "file feed: inotify_init1 failed");
+
+	// the directory, not the file: an editor or "mv new status" replaces
+	// the file by a new one which a watch on the old one would miss.
+	// not IN_CREATE: the file would be read before it was written.
+	// IN_DELETE and IN_MOVED_FROM: the box is cleared when it is gone
+	if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) == -1)
+		error_exit(true, "file feed: cannot watch %s", dir.c_str());
+
+	th = new std::thread(std::ref(*this));
+}
+
+file_feed::~file_feed()
+{
+	th->join();
+	delete th;
+
+	close(fd);
+}
+
+// returns false if the file can't be read (e.g. not there yet)
+bool file_feed::read_file()
+{
+	int file_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file_fd == -1)
+		return false;
+
+	// keeps its capacity between reads
+	buffer.clear();
+
+	for(;;) {
+		size_t offset = buffer.size();
+		buffer.resize(offset + 65536);
+
+		ssize_t n = read(file_fd, &buffer[offset], 65536);
+		if (n <= 0) {
+			buffer.resize(offset);
+			break;
+		}
+
+		buffer.resize(offset + n);
+	}
+
+	close(file_fd);
+
+	return true;
+}
+
+void file_feed::push()
+{
+	if (!read_file()) {
+		// deleted or moved away: don't keep showing the old contents
+		if (shown)
+			publish({ }, get_us(), path);
+
+		shown = false;
+
+		return;
+	}
+
+	shown = true;
+
+	uint64_t arrival_us = get_us();
+
+	std::vector<std::string> parts = split(buffer, "\n");
+
+	// the newline at the end of the last line
+	if (parts.empty() == false && parts.back().empty())
+		parts.pop_back();
+
+	publish(parts, arrival_us, path);
+}
+
+void file_feed::operator()()
+{
+	set_thread_name("file");
+
+	push();
+
+	alignas(struct inotify_event) char events[sizeof(struct inotify_event) + NAME_MAX + 1] { 0 };
+
+	while(!do_exit) {
+		struct pollfd fds[] { { fd, POLLIN, 0 } };
+
+		if (poll(fds, 1, 500) != 1)
+			continue;
+
+		bool changed = false;
+
+		for(;;) {
+			ssize_t n = read(fd, events, sizeof events);
+			if (n <= 0)
+				break;
+
+			for(ssize_t offset = 0; offset < n;) {
+				const struct inotify_event *ev = reinterpret_cast<const struct inotify_event *>(&events[offset]);
+
+				if (ev->len && name == ev->name)
+					changed = true;
+
+				offset += sizeof(struct inotify_event) + ev->len;
+			}
+		}
+
+		// multiple events for one change are handled by one read
+		if (changed)
+			push();
+	}
+}
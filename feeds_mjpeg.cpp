@@ -8,6 +8,8 @@
 
 #include "error.h"
 #include "feeds.h"
+#include "feeds_mjpeg.h"
+#include "timing.h"
 
 
 bool read_JPEG_memory(tjhandle jpeg_decompressor, unsigned char *in, int n_bytes_in, int *w, int *h, unsigned char **pixels)
@@ -26,13 +28,6 @@ bool read_JPEG_memory(tjhandle jpeg_decompressor, unsigned char *in, int n_bytes
 	return true;
 }
 
-typedef struct
-{
-	uint8_t *data;
-	size_t   len;
-	char    *boundary;
-} work_header_t;
-
 static size_t write_headers(void *ptr, size_t size, size_t nmemb, void *mypt)
 {
 	work_header_t *pctx = reinterpret_cast<work_header_t *>(mypt);
@@ -85,24 +80,12 @@ static size_t write_headers(void *ptr, size_t size, size_t nmemb, void *mypt)
 	return n;
 }
 
-typedef struct
-{
-	work_header_t *headers;
-	container     *c;
-	bool           first;
-	bool           header;
-	uint8_t       *data;
-	size_t         n;
-	size_t         req_len;
-	tjhandle       jpeg_decompressor;
-} work_data_t;
-
 static int xfer_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
 {
 	return 0;
 }
 
-static size_t write_data(void *ptr, size_t size, size_t nmemb, void *mypt)
+size_t write_data(void *ptr, size_t size, size_t nmemb, void *mypt)
 {
 	work_data_t *w         = (work_data_t *)mypt;
 	const size_t full_size = size * nmemb;
@@ -157,11 +140,12 @@ process:
 	else if (w -> n >= w -> req_len && w -> req_len) {
 		//printf("frame! (%p %zu/%zu)\n", w -> data, w -> n, w -> req_len);
 
+		uint64_t       arrival_us = get_us();
 		int            dw   = 0;
 		int            dh   = 0;
 		unsigned char *temp = NULL;
 		if (read_JPEG_memory(w->jpeg_decompressor, w->data, w->req_len, &dw, &dh, &temp)) {
-			w->c->set_pixels(temp, dw, dh);
+			w->f->publish_pixels(temp, dw, dh, arrival_us);
 			free(temp);
 
 			if (w->first) {
@@ -264,7 +248,7 @@ void mjpeg_feed::operator()()
 		curl_easy_setopt(ch, CURLOPT_TCP_FASTOPEN, 1);
 
 		work_data_t *w = new work_data_t;
-		w -> c = c;
+		w -> f = this;
 		w -> first = w -> header = true;
 		w -> data = NULL;
 		w -> n = 0;
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <turbojpeg.h>
+
+#include "feeds.h"
+
+
+typedef struct
+{
+	uint8_t *data;
+	size_t   len;
+	char    *boundary;
+} work_header_t;
+
+typedef struct
+{
+	work_header_t *headers;
+	feed          *f;
+	bool           first;
+	bool           header;
+	uint8_t       *data;
+	size_t         n;
+	size_t         req_len;
+	tjhandle       jpeg_decompressor;
+} work_data_t;
+
+bool read_JPEG_memory(tjhandle jpeg_decompressor, unsigned char *in, int n_bytes_in, int *w, int *h, unsigned char **pixels);
+
+// curl write callback: splits a multipart stream into frames
+size_t write_data(void *ptr, size_t size, size_t nmemb, void *mypt);
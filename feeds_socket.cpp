@@ -0,0 +1,246 @@
+#include <cerrno>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "error.h"
+#include "feeds.h"
+#include "timing.h"
+#include "trace.h"
+
+
+extern std::atomic_bool do_exit;
+
+// messages received with one recvmmsg call at most
+constexpr const unsigned int max_batch   = 32;
+constexpr const size_t       max_msg_len = 65536;
+
+// one listener per socket path, shared by all socket feeds on it
+static std::mutex                                listeners_lock;
+static std::map<std::string, socket_listener *>  listeners;
+
+socket_listener::socket_listener(const std::string & path) : path(path)
+{
+	sockaddr_un addr { };
+	addr.sun_family = AF_UNIX;
+
+	if (path.size() >= sizeof addr.sun_path)
+		error_exit(false, "socket feed: path %s is too long", path.c_str());
+
+	strcpy(addr.sun_path, path.c_str());
+
+	fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd == -1)
+		error_exit(true, "socket feed: cannot create socket");
+
+	struct stat st { };
+	if (lstat(path.c_str(), &st) == 0) {
+		if (!S_ISSOCK(st.st_mode))
+			error_exit(false, "socket feed: %s exists and is not a socket", path.c_str());
+
+		// only a socket left behind by a previous run is replaced
+		if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) == 0)
+			error_exit(false, "socket feed: %s is in use by another process", path.c_str());
+
+		if (errno != ECONNREFUSED)
+			error_exit(true, "socket feed: cannot check %s", path.c_str());
+
+		unlink(path.c_str());
+	}
+
+	if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) == -1)
+		error_exit(true, "socket feed: cannot bind to %s", path.c_str());
+
+	if (lstat(path.c_str(), &st) == -1)
+		error_exit(true, "socket feed: cannot stat %s", path.c_str());
+
+	dev = st.st_dev;
+	ino = st.st_ino;
+
+	buffers = new char[max_batch * max_msg_len];
+
+	th = new std::thread(std::ref(*this));
+}
+
+socket_listener::~socket_listener()
+{
+	stop_flag = true;
+
+	th->join();
+	delete th;
+
+	close(fd);
+
+	// it may since have been replaced by another instance
+	struct stat st { };
+	if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) && st.st_dev == dev && st.st_ino == ino)
+		unlink(path.c_str());
+
+	delete [] buffers;
+}
+
+socket_listener *socket_listener::get(const std::string & path)
+{
+	trace_lock(listeners_lock, "wait listeners lock");
+
+	auto it = listeners.find(path);
+	if (it == listeners.end())
+		it = listeners.insert({ path, new socket_listener(path) }).first;
+
+	socket_listener *l = it->second;
+	l->n_users++;
+
+	listeners_lock.unlock();
+
+	return l;
+}
+
+void socket_listener::release(socket_listener *const l)
+{
+	trace_lock(listeners_lock, "wait listeners lock");
+
+	if (--l->n_users == 0) {
+		listeners.erase(l->path);
+
+		delete l;
+	}
+
+	listeners_lock.unlock();
+}
+
+void socket_listener::add(const std::string & key, feed *const f)
+{
+	trace_lock(lock, "wait listener lock");
+
+	if (feeds.find(key) != feeds.end())
+		error_exit(false, "socket feed: key \"%s\" is used twice on %s", key.c_str(), path.c_str());
+
+	feeds.insert({ key, f });
+
+	lock.unlock();
+}
+
+void socket_listener::remove(const std::string & key)
+{
+	std::unique_lock<std::mutex> lck(lock);
+
+	auto it = feeds.find(key);
+	if (it == feeds.end())
+		return;
+
+	feed *f = it->second;
+	feeds.erase(it);
+
+	publish_done.wait(lck, [&] { return publishing != f; });
+}
+
+// only the listener thread gets here
+void socket_listener::report_invalid()
+{
+	n_invalid++;
+
+	report_nth(n_invalid, "socket feed %s: %" PRIu64 " messages without a known key or too long\n", path.c_str(), n_invalid);
+}
+
+// a datagram is "key\npayload"
+void socket_listener::route(const char *const msg, const size_t len, const uint64_t arrival_us)
+{
+	const char *lf = static_cast<const char *>(memchr(msg, '\n', len));
+	if (!lf) {
+		report_invalid();
+		return;
+	}
+
+	std::string key(msg, lf - msg);
+
+	trace_lock(lock, "wait listener lock");
+
+	auto it = feeds.find(key);
+	if (it != feeds.end())
+		publishing = it->second;
+
+	lock.unlock();
+
+	if (!publishing) {
+		report_invalid();
+		return;
+	}
+
+	publishing->publish({ std::string(lf + 1, msg + len) }, arrival_us, key);
+
+	trace_lock(lock, "wait listener lock");
+	publishing = nullptr;
+	lock.unlock();
+
+	publish_done.notify_all();
+}
+
+void socket_listener::operator()()
+{
+	set_thread_name("socket");
+
+	mmsghdr msgs[max_batch];
+	iovec   iovs[max_batch];
+
+	for(unsigned int i=0; i<max_batch; i++) {
+		iovs[i] = { &buffers[i * max_msg_len], max_msg_len };
+
+		msgs[i] = { };
+		msgs[i].msg_hdr.msg_iov    = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while(!do_exit && !stop_flag) {
+		struct pollfd fds[] { { fd, POLLIN, 0 } };
+
+		if (poll(fds, 1, 500) != 1)
+			continue;
+
+		// drain everything that is queued, a batch per system call
+		for(;;) {
+			int n = recvmmsg(fd, msgs, max_batch, MSG_DONTWAIT, nullptr);
+			if (n <= 0)
+				break;
+
+			uint64_t arrival_us = get_us();
+
+			for(int i=0; i<n; i++) {
+				// cut off at max_msg_len: publishing it would show half a message
+				if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+					report_invalid();
+				else
+					route(&buffers[i * max_msg_len], msgs[i].msg_len, arrival_us);
+			}
+
+			if (unsigned(n) < max_batch)
+				break;
+		}
+	}
+}
+
+socket_feed::socket_feed(const std::string & path, const std::string & key, container *const c) : feed(c), key(key)
+{
+	listener = socket_listener::get(path);
+
+	listener->add(key, this);
+}
+
+socket_feed::~socket_feed()
+{
+	listener->remove(key);
+
+	socket_listener::release(listener);
+}
+
+void socket_feed::operator()()
+{
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cinttypes>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "error.h"
+#include "feeds.h"
+#include "proc.h"
+#include "str.h"
+#include "timing.h"
+
+
+extern std::atomic_bool do_exit;
+
+static const char *const words[] = { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa" };
+constexpr const size_t n_words = sizeof(words) / sizeof(words[0]);
+
+synthetic_feed::synthetic_feed(const synthetic_mode_t mode, const std::string & json_template, const size_t size, const double min_value, const double max_value, const double rate, const double ramp_step, const int ramp_interval, const uint64_t seed, container *const c) :
+	feed(c),
+	mode(mode), json_template(json_template), size(size),
+	min_value(min_value), max_value(max_value),
+	rate(rate), ramp_step(ramp_step), ramp_interval(ramp_interval),
+	rng(seed)
+{
+	if (rate <= 0.)
+		error_exit(false, "synthetic feed: rate must be > 0");
+
+	th = new std::thread(std::ref(*this));
+}
+
+synthetic_feed::~synthetic_feed()
+{
+	th->join();
+	delete th;
+}
+
+double synthetic_feed::random_value(const double mi, const double ma)
+{
+	return std::uniform_real_distribution<double>(mi, ma)(rng);
+}
+
+std::string synthetic_feed::random_word()
+{
+	return words[rng() % n_words];
+}
+
+// $int:min:max$, $float:min:max:digits$, $hex:n$, $word$, $seq$
+std::string synthetic_feed::expand(const std::string & cmd)
+{
+	auto parts = split(cmd, ":");
+
+	if (parts.at(0) == "int" && parts.size() == 3) {
+		int64_t mi = atoll(parts.at(1).c_str());
+		int64_t ma = atoll(parts.at(2).c_str());
+
+		return myformat("%" PRId64, std::uniform_int_distribution<int64_t>(mi, std::max(mi, ma))(rng));
+	}
+
+	if (parts.at(0) == "float" && parts.size() == 4)
+		return myformat("%.*f", atoi(parts.at(3).c_str()), random_value(atof(parts.at(1).c_str()), atof(parts.at(2).c_str())));
+
+	if (parts.at(0) == "hex" && parts.size() == 2) {
+		std::string out;
+
+		for(int i=atoi(parts.at(1).c_str()); i>0; i--)
+			out += "0123456789abcdef"[rng() & 15];
+
+		return out;
+	}
+
+	if (parts.at(0) == "word")
+		return random_word();
+
+	if (parts.at(0) == "seq")
+		return myformat("%" PRIu64, seq);
+
+	error_exit(false, "synthetic feed: \"%s\" is not understood", cmd.c_str());
+
+	return "";
+}
+
+std::vector<std::string> synthetic_feed::generate()
+{
+	seq++;
+
+	if (mode == sm_numbers) {
+		std::vector<std::string> out;
+
+		for(size_t i=0; i<size; i++)
+			out.push_back(myformat("%f", random_value(min_value, max_value)));
+
+		return out;
+	}
+
+	if (mode == sm_json) {
+		std::string out;
+		std::string cmd;
+		bool        get_cmd = false;
+
+		for(auto c : json_template) {
+			if (get_cmd) {
+				if (c == '$') {
+					out += expand(cmd);
+					get_cmd = false;
+				}
+				else {
+					cmd += c;
+				}
+			}
+			else if (c == '$') {
+				get_cmd = true;
+				cmd.clear();
+			}
+			else {
+				out += c;
+			}
+		}
+
+		return { out };
+	}
+
+	// ticker
+	std::string out;
+	out.reserve(size + 16);
+
+	while(out.size() < size) {
+		if (out.empty() == false)
+			out += ' ';
+
+		out += random_word();
+	}
+
+	out.resize(size);
+
+	return { out };
+}
+
+void synthetic_feed::operator()()
+{
+	set_thread_name("synthetic");
+
+	uint64_t next_us      = get_us();
+	uint64_t next_ramp_us = next_us + ramp_interval * uint64_t(1000000);
+	uint64_t n_behind     = 0;
+
+	while(!do_exit) {
+		std::vector<std::string> text = generate();
+
+		publish(text, get_us());
+
+		next_us += uint64_t(1000000 / rate);
+
+		uint64_t now = get_us();
+
+		if (next_us > now)
+			usleep(next_us - now);
+		// more than a second behind: the container can't keep up, don't burst to catch up
+		else if (now - next_us > 1000000) {
+			n_behind++;
+
+			report_nth(n_behind, "synthetic feed: cannot keep up with %.1f messages per second (%" PRIu64 " times)\n", rate, n_behind);
+
+			next_us = now;
+		}
+
+		if (ramp_step > 0. && ramp_interval > 0 && now >= next_ramp_us) {
+			rate += ramp_step;
+
+			printf("synthetic feed: %.1f messages per second\n", rate);
+
+			next_ramp_us += ramp_interval * uint64_t(1000000);
+		}
+	}
+}
@@ -0,0 +1,274 @@
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "error.h"
+#include "feeds.h"
+#include "str.h"
+#include "timing.h"
+
+
+extern std::atomic_bool do_exit;
+
+// the parsers below work in-place on the read buffers and don't allocate
+
+static const char *skip_spaces(const char *p)
+{
+	while(*p == ' ' || *p == '\t')
+		p++;
+
+	return p;
+}
+
+static uint64_t parse_u64(const char **const p)
+{
+	const char *q = skip_spaces(*p);
+	uint64_t    v = 0;
+
+	while(*q >= '0' && *q <= '9')
+		v = v * 10 + (*q++ - '0');
+
+	*p = q;
+
+	return v;
+}
+
+// only handles the non-negative "12.34" format of /proc/loadavg
+static double parse_decimal(const char **const p)
+{
+	double v = double(parse_u64(p));
+
+	if (**p == '.') {
+		(*p)++;
+
+		double scale = 0.1;
+
+		while(**p >= '0' && **p <= '9') {
+			v += (*(*p)++ - '0') * scale;
+			scale /= 10;
+		}
+	}
+
+	return v;
+}
+
+// value of a "Key:   123 kB" line
+static uint64_t meminfo_value(const char *const buffer, const char *const key)
+{
+	const char *p = strstr(buffer, key);
+	if (!p)
+		return 0;
+
+	p += strlen(key);
+
+	return parse_u64(&p);
+}
+
+static int open_ro(const std::string & file, const bool optional)
+{
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1 && !optional)
+		error_exit(true, "sysstat feed: cannot open %s", file.c_str());
+
+	return fd;
+}
+
+sysstat_feed::sysstat_feed(const int interval_ms, const std::string & interface, const int thermal_zone, container *const c) :
+	feed(c), interval_ms(interval_ms), interface(interface)
+{
+	fd_loadavg = open_ro("/proc/loadavg", false);
+	fd_meminfo = open_ro("/proc/meminfo", false);
+	fd_stat    = open_ro("/proc/stat",    false);
+	fd_net     = open_ro("/proc/net/dev", false);
+	// not all systems have one
+	fd_thermal = open_ro(myformat("/sys/class/thermal/thermal_zone%d/temp", thermal_zone), true);
+
+	th = new std::thread(std::ref(*this));
+}
+
+sysstat_feed::~sysstat_feed()
+{
+	th->join();
+	delete th;
+
+	close(fd_loadavg);
+	close(fd_meminfo);
+	close(fd_stat);
+	close(fd_net);
+
+	if (fd_thermal != -1)
+		close(fd_thermal);
+}
+
+// the whole file from the start, 0-terminated
+bool sysstat_feed::read_file(const int fd)
+{
+	ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+	if (n < 0) {
+		buffer[0] = 0x00;
+
+		return false;
+	}
+
+	buffer[n] = 0x00;
+
+	return true;
+}
+
+// first line: "cpu  user nice system idle iowait irq softirq steal ..."
+void sysstat_feed::read_cpu(uint64_t *const busy, uint64_t *const total)
+{
+	*busy  = 0;
+	*total = 0;
+
+	if (!read_file(fd_stat) || strncmp(buffer, "cpu ", 4) != 0)
+		return;
+
+	const char *p = buffer + 4;
+
+	for(int i=0; i<8; i++) {
+		uint64_t v = parse_u64(&p);
+
+		*total += v;
+
+		// idle and iowait
+		if (i != 3 && i != 4)
+			*busy += v;
+	}
+}
+
+// "  eth0: rx_bytes rx_packets ... (8 rx fields) tx_bytes ..."
+void sysstat_feed::read_net(uint64_t *const rx, uint64_t *const tx)
+{
+	*rx = 0;
+	*tx = 0;
+
+	if (!read_file(fd_net))
+		return;
+
+	const char *p = buffer;
+
+	while(*p) {
+		const char *eol   = strchr(p, '\n');
+		const char *colon = strchr(p, ':');
+
+		if (colon && (!eol || colon < eol)) {
+			const char *name = skip_spaces(p);
+			size_t      len  = colon - name;
+
+			bool selected = interface.empty() ? !(len == 2 && memcmp(name, "lo", 2) == 0) : (len == interface.size() && memcmp(name, interface.c_str(), len) == 0);
+
+			if (selected) {
+				const char *q = colon + 1;
+
+				*rx += parse_u64(&q);
+
+				for(int i=0; i<7; i++)
+					parse_u64(&q);
+
+				*tx += parse_u64(&q);
+			}
+		}
+
+		if (!eol)
+			break;
+
+		p = eol + 1;
+	}
+}
+
+void sysstat_feed::operator()()
+{
+	set_thread_name("sysstat");
+
+	uint64_t prev_busy = 0, prev_total = 0;
+	uint64_t prev_rx   = 0, prev_tx    = 0;
+	uint64_t prev_us   = 0;
+
+	uint64_t next_us   = get_us();
+
+	char json[512];
+
+	while(!do_exit) {
+		uint64_t now_us = get_us();
+
+		double load[3] { };
+		if (read_file(fd_loadavg)) {
+			const char *p = buffer;
+
+			for(int i=0; i<3; i++)
+				load[i] = parse_decimal(&p);
+		}
+
+		uint64_t mem_total_kb = 0, mem_available_kb = 0;
+		if (read_file(fd_meminfo)) {
+			mem_total_kb     = meminfo_value(buffer, "MemTotal:");
+			mem_available_kb = meminfo_value(buffer, "MemAvailable:");
+		}
+
+		uint64_t busy = 0, total = 0;
+		read_cpu(&busy, &total);
+
+		uint64_t rx = 0, tx = 0;
+		read_net(&rx, &tx);
+
+		// the first sample has nothing to compare with
+		double cpu_pct = 0., rx_kbps = 0., tx_kbps = 0.;
+
+		if (prev_us) {
+			double dt = (now_us - prev_us) / 1000000.;
+
+			if (total > prev_total)
+				cpu_pct = (busy - prev_busy) * 100. / (total - prev_total);
+
+			// counters restart when an interface goes down
+			if (dt > 0. && rx >= prev_rx && tx >= prev_tx) {
+				rx_kbps = (rx - prev_rx) * 8 / 1000. / dt;
+				tx_kbps = (tx - prev_tx) * 8 / 1000. / dt;
+			}
+		}
+
+		prev_busy  = busy;
+		prev_total = total;
+		prev_rx    = rx;
+		prev_tx    = tx;
+		prev_us    = now_us;
+
+		double mem_used_pct = mem_total_kb ? (mem_total_kb - mem_available_kb) * 100. / mem_total_kb : 0.;
+
+		// floating point values always have a '.' so that jsondval accepts them
+		int n = snprintf(json, sizeof json, "{\"load1\":%.2f,\"load5\":%.2f,\"load15\":%.2f,\"mem_total_mb\":%" PRIu64 ",\"mem_available_mb\":%" PRIu64 ",\"mem_used_pct\":%.1f,\"cpu_pct\":%.1f,\"net_rx_kbps\":%.1f,\"net_tx_kbps\":%.1f",
+				load[0], load[1], load[2], mem_total_kb / 1024, mem_available_kb / 1024, mem_used_pct, cpu_pct, rx_kbps, tx_kbps);
+
+		// millidegrees
+		if (fd_thermal != -1 && read_file(fd_thermal)) {
+			const char *p   = buffer;
+			bool        neg = *p == '-';
+
+			if (neg)
+				p++;
+
+			double temp = parse_u64(&p) / 1000.;
+
+			n += snprintf(json + n, sizeof(json) - n, ",\"temp_c\":%.1f", neg ? -temp : temp);
+		}
+
+		snprintf(json + n, sizeof(json) - n, "}");
+
+		publish({ json }, now_us, "sysstat");
+
+		next_us += interval_ms * uint64_t(1000);
+
+		uint64_t after_us = get_us();
+
+		if (next_us > after_us)
+			usleep(next_us - after_us);
+		else
+			next_us = after_us;
+	}
+}
@@ -1,3 +1,7 @@
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <ctype.h>
 #include <jansson.h>
 #include <optional>
 #include <regex>
@@ -188,8 +192,6 @@ std::string json_formatter::process(const std::string & in)
 
 	json_decref(j);
 
-	printf("%s\n", out.c_str());
-
 	return out;
 }
 
@@ -202,16 +204,38 @@ value_formatter::~value_formatter() {
 
 std::string value_formatter::process(const std::string & in)
 {
-	try {
-		double value = std::stod(in);
+	const char *start = in.data();
+	const char *end   = in.data() + in.size();
 
-		if (n_digits == 0)
-			return myformat("%d", value);
+	while(start < end && isspace(*start))
+		start++;
 
-		return myformat("%.*f", n_digits, value);
-	}
-	catch(...) {
+	// strtod() accepted these, from_chars() does not
+	if (start < end && *start == '+')
+		start++;
+
+	double value = 0.;
+	if (std::from_chars(start, end, value).ec != std::errc())
+		return in;
+
+	char buffer[64];
+	std::to_chars_result rc;
+
+	// llround() of these is undefined
+	if (std::isfinite(value) == false)
+		return in;
+
+	if (n_digits == 0) {
+		if (value <= double(LLONG_MIN) || value >= double(LLONG_MAX))
+			return in;
+
+		rc = std::to_chars(buffer, buffer + sizeof buffer, std::llround(value));
 	}
+	else
+		rc = std::to_chars(buffer, buffer + sizeof buffer, value, std::chars_format::fixed, n_digits);
+
+	if (rc.ec != std::errc())
+		return in;
 
-	return in;
+	return std::string(buffer, rc.ptr);
 }
@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <vector>
+
+#include "background.h"
+#include "container.h"
+#include "error.h"
+#include "frame.h"
+#include "profiler.h"
+#include "timing.h"
+#include "trace.h"
+
+
+// draws the background and all containers; prof is optional
+// returns the number of draw calls issued
+int draw_frame(screen_descriptor_t *const sd, background *const bg, const std::vector<container_t> & containers, profiler *const prof)
+{
+	int n_draw_calls = 0;
+
+	uint64_t start_us = get_us();
+	{
+		TRACE_SPAN("background");
+		n_draw_calls += bg->put(sd, containers);
+	}
+
+	if (prof)
+		prof->add_background(get_us() - start_us);
+
+	for(size_t i=0; i<containers.size(); i++) {
+		auto & c = containers.at(i);
+
+		if (c.baked)
+			continue;
+
+		start_us = get_us();
+
+		if (c.ct == ct_static) {
+			TRACE_SPAN("put_static");
+			n_draw_calls += c.c->put_static(sd, c.x, c.y, c.w, c.h, c.center_h, c.center_v);
+		}
+		else if (c.ct == ct_scroller) {
+			TRACE_SPAN("put_scroller");
+			n_draw_calls += c.c->put_scroller(sd, c.x, c.y, c.w, c.h);
+		}
+		else
+			error_exit(false, "Internal error: unknown container type %d", c.ct);
+
+		if (prof)
+			prof->add_container(i, get_us() - start_us);
+	}
+
+	return n_draw_calls;
+}
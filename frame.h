@@ -0,0 +1,8 @@
+#include <vector>
+
+#include "background.h"
+#include "container.h"
+#include "profiler.h"
+
+
+int draw_frame(screen_descriptor_t *const sd, background *const bg, const std::vector<container_t> & containers, profiler *const prof);
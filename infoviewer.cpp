@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <atomic>
+#include <getopt.h>
 #include <libconfig.h++>
 #include <math.h>
 #include <mosquitto.h>
@@ -15,10 +16,21 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "background.h"
+#include "config.h"
 #include "error.h"
 #include "feeds.h"
 #include "formatters.h"
+#include "frame.h"
+#include "metrics.h"
+#include "proc.h"
+#include "profiler.h"
+#include "record.h"
+#include "snapshot.h"
 #include "str.h"
+#include "texture_budget.h"
+#include "timing.h"
+#include "trace.h"
 
 
 std::atomic_bool do_exit { false };
@@ -28,125 +40,112 @@ void sigh(int s)
 	do_exit = true;
 }
 
-std::string cfg_str(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const std::string & def)
-{
-	std::string v = def;
-
-	try {
-		v = (const char *)cfg.lookup(key.c_str());
-	}
-	catch(const libconfig::SettingNotFoundException &nfex) {
-		if (!optional)
-			error_exit(false, "\"%s\" not found (%s)", key.c_str(), descr);
-	}
-	catch(const libconfig::SettingTypeException & ste) {
-		error_exit(false, "Expected a string value for \"%s\" (%s) at line %d but got something else (%s)", key.c_str(), descr, cfg.getSourceLine(), ste.what());
-	}
-
-	return v;
-}
-
-double cfg_float(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const double def=-1.0)
-{
-	double v = def;
-
-	try {
-		cfg.lookupValue(key.c_str(), v);
-	}
-	catch(const libconfig::SettingNotFoundException &nfex) {
-		if (!optional)
-			error_exit(false, "\"%s\" not found (%s)", key.c_str(), descr);
-	}
-	catch(const libconfig::SettingTypeException & ste) {
-		error_exit(false, "Expected a float value for \"%s\" (%s) at line %d but got something else (did you forget to add \".0\"?)", key.c_str(), descr, cfg.getSourceLine());
-	}
-
-	return v;
-}
-
-int cfg_int(const libconfig::Setting & cfg, const std::string & key, const char *descr, const bool optional, const int def=-1)
-{
-	int v = def;
-
-	try {
-		v = cfg.lookup(key.c_str());
-	}
-	catch(const libconfig::SettingNotFoundException &nfex) {
-		if (!optional)
-			error_exit(false, "\"%s\" not found (%s)", key.c_str(), descr);
-	}
-	catch(const libconfig::SettingTypeException & ste) {
-		error_exit(false, "Expected an int value for \"%s\" (%s) at line %d but got something else", key.c_str(), descr, cfg.getSourceLine());
-	}
-
-	return v;
-}
-
-int cfg_bool(const libconfig::Setting & cfg, const char *const key, const char *descr, const bool optional, const bool def=false)
-{
-	bool v = def;
+std::atomic_bool snapshot_requested { false };
 
-	try {
-		v = cfg.lookup(key);
-	}
-	catch(const libconfig::SettingNotFoundException &nfex) {
-		if (!optional)
-			error_exit(false, "\"%s\" not found (%s)", key, descr);
-	}
-	catch(const libconfig::SettingTypeException & ste) {
-		error_exit(false, "Expected a boolean value for \"%s\" (%s) but got something else", key, descr);
-	}
-
-	return v;
-}
-
-void set_thread_name(const std::string & name)
+void sigh_snapshot(int s)
 {
-	std::string full_name = "IV:" + name;
-
-	if (full_name.length() > 15)
-		full_name = full_name.substr(0, 15);
-
-	pthread_setname_np(pthread_self(), full_name.c_str());
+	snapshot_requested = true;
 }
 
-void draw_box(screen_descriptor_t *const sd, const int x, const int y, const int w, const int h, const bool border, const int r, const int g, const int b, const int b_r, const int b_g, const int b_b)
+void help()
 {
-	assert(sd->screen);
-
-	int x1 = x * sd->xsteps;
-	int y1 = y * sd->ysteps;
-	int x2 = x1 + sd->xsteps * w - 1;
-	int y2 = y1 + sd->ysteps * h - 1;
-
-	boxRGBA(sd->screen, x1, y1, x2, y2, r, g, b, 255);
-
-	if (border)
-		rectangleRGBA(sd->screen, x1, y1, x2, y2, b_r, b_g, b_b, 191);
+	fprintf(stderr, "infoviewer [options] configuration-file\n");
+	fprintf(stderr, "--headless WxH          render into an off-screen surface of WxH pixels\n");
+	fprintf(stderr, "--frames n              stop after n frames\n");
+	fprintf(stderr, "--seconds n             stop after n seconds\n");
+	fprintf(stderr, "--snapshot-dir dir      where to write PNG snapshots (also on SIGUSR1)\n");
+	fprintf(stderr, "--snapshot-interval n   write a snapshot every n seconds\n");
+	fprintf(stderr, "--record file           log all data entering the feeds to file\n");
+	fprintf(stderr, "--replay file           show a recording instead of the live feeds (static feeds stay)\n");
+	fprintf(stderr, "--replay-speed x        replay x times as fast, 0 for as fast as possible (default: 1)\n");
+	fprintf(stderr, "--trace file            write spans in the Chrome trace format at exit (needs a WITH_TRACE build)\n");
 }
 
 std::mutex ttf_lock;
-typedef enum { ct_static, ct_scroller } container_type_t;
-
-typedef struct {
-	container *c;
-	container_type_t ct;
-	int font_r, font_g, font_b;
-	int bg_r, bg_g, bg_b;
-	int b_r, b_g, b_b;
-	int x, y, w, h;
-	bool border, center_h, center_v, bg_fill;
-} container_t;
 
 int main(int argc, char *argv[])
 {
 	signal(SIGTERM, sigh);
+	signal(SIGUSR1, sigh_snapshot);
+
+	bool        headless          = false;
+	int         headless_w        = 0;
+	int         headless_h        = 0;
+	uint64_t    max_frames        = 0;
+	int         max_seconds       = 0;
+	std::string snapshot_dir;
+	int         snapshot_interval = 0;
+	std::string record_file;
+	std::string replay_file;
+	double      replay_speed      = 1.;
+	std::string trace_file;
+
+	static struct option long_options[] =
+	{
+		{ "headless",          required_argument, nullptr, 'H' },
+		{ "frames",            required_argument, nullptr, 'f' },
+		{ "seconds",           required_argument, nullptr, 's' },
+		{ "snapshot-dir",      required_argument, nullptr, 'd' },
+		{ "snapshot-interval", required_argument, nullptr, 'i' },
+		{ "record",            required_argument, nullptr, 'r' },
+		{ "replay",            required_argument, nullptr, 'R' },
+		{ "replay-speed",      required_argument, nullptr, 'x' },
+		{ "trace",             required_argument, nullptr, 't' },
+		{ "help",              no_argument,       nullptr, 'h' },
+		{ nullptr,             0,                 nullptr, 0   }
+	};
+
+	int opt = -1;
+	while((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+		if (opt == 'H') {
+			headless = true;
+
+			if (sscanf(optarg, "%dx%d", &headless_w, &headless_h) != 2 || headless_w <= 0 || headless_h <= 0) {
+				fprintf(stderr, "--headless expects WxH (e.g. 1920x1080)\n");
+				return 1;
+			}
+		}
+		else if (opt == 'f')
+			max_frames = atoll(optarg);
+		else if (opt == 's')
+			max_seconds = atoi(optarg);
+		else if (opt == 'd')
+			snapshot_dir = optarg;
+		else if (opt == 'i')
+			snapshot_interval = atoi(optarg);
+		else if (opt == 'r')
+			record_file = optarg;
+		else if (opt == 'R')
+			replay_file = optarg;
+		else if (opt == 'x')
+			replay_speed = atof(optarg);
+		else if (opt == 't')
+			trace_file = optarg;
+		else {
+			help();
+			return opt == 'h' ? 0 : 1;
+		}
+	}
 
-	if (argc != 2) {
+	if (optind != argc - 1) {
 		fprintf(stderr, "Configuration file parameter missing\n");
+		help();
 		return 1;
 	}
 
+	const char *const cfg_file = argv[optind];
+
+#ifdef WITH_TRACE
+	trace_thread_name("main");
+#else
+	if (trace_file.empty() == false)
+		fprintf(stderr, "Built without WITH_TRACE: --trace is ignored\n");
+#endif
+
+	// no display required
+	if (headless)
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
 	if (SDL_Init(SDL_INIT_VIDEO) == -1) {
                 fprintf(stderr, "Failed to initialize SDL video subsystem\n");
                 return 1;
@@ -166,10 +165,10 @@ int main(int argc, char *argv[])
 #endif
 
         try {
-                cfg.readFile(argv[1]);
+                cfg.readFile(cfg_file);
         }
         catch(const libconfig::FileIOException &fioex) {
-                fprintf(stderr, "I/O error while reading configuration file %s\n", argv[1]);
+                fprintf(stderr, "I/O error while reading configuration file %s\n", cfg_file);
                 return 1;
         }
         catch(const libconfig::ParseException &pex) {
@@ -189,6 +188,18 @@ int main(int argc, char *argv[])
 
 	int  display_nr  = 0;
 
+	std::string stats_file;
+	int  stats_interval = 10;
+	std::string overlay_font;
+	int  overlay_font_height = 16;
+
+	std::string metrics_file;
+	int  metrics_interval = 10;
+	std::string metrics_listen;
+	int  metrics_port = -1;
+
+	int  texture_budget_mb = 0;
+
 	try {
 		const libconfig::Setting & global = root.lookup("global");
 
@@ -202,6 +213,18 @@ int main(int argc, char *argv[])
 		create_h = cfg_int(global, "window-h", "when not full screen, window height", true, 480);
 
 		display_nr = cfg_int(global, "display-nr", "with multiple monitors, use this monitor", true, 1);
+
+		stats_file = cfg_str(global, "stats-file", "append render statistics to this file", true, "");
+		stats_interval = cfg_int(global, "stats-interval", "statistics interval (in seconds)", true, 10);
+		overlay_font = cfg_str(global, "overlay-font", "font for the statistics overlay", true, "/usr/share/fonts/truetype/freefont/FreeMono.ttf");
+		overlay_font_height = cfg_int(global, "overlay-font-height", "font height of the statistics overlay (in pixels)", true, 16);
+
+		metrics_file = cfg_str(global, "metrics-file", "write prometheus metrics to this file", true, "");
+		metrics_interval = cfg_int(global, "metrics-interval", "metrics file update interval (in seconds)", true, 10);
+		metrics_listen = cfg_str(global, "metrics-listen", "IPv4 address to serve metrics on", true, "127.0.0.1");
+		metrics_port = cfg_int(global, "metrics-port", "TCP port to serve metrics on (-1 to disable)", true, -1);
+
+		texture_budget_mb = cfg_int(global, "texture-budget", "texture memory budget (in MB, 0 for no limit)", true, 0);
 	}
 	catch(libconfig::SettingNotFoundException & e) {
                 fprintf(stderr, "Configuration group \"global\" not found!\n");
@@ -210,214 +233,118 @@ int main(int argc, char *argv[])
 
 	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
 
-	SDL_Window *win = SDL_CreateWindow("InfoViewer",
+	SDL_Window   *win    = nullptr;
+	SDL_Surface  *canvas = nullptr;
+	SDL_Renderer *screen = nullptr;
+
+	int w = 0;
+	int h = 0;
+
+	if (headless) {
+		canvas = SDL_CreateRGBSurfaceWithFormat(0, headless_w, headless_h, 32, SDL_PIXELFORMAT_ARGB8888);
+		assert(canvas);
+
+		screen = SDL_CreateSoftwareRenderer(canvas);
+		assert(screen);
+
+		w = headless_w;
+		h = headless_h;
+	}
+	else {
+		win = SDL_CreateWindow("InfoViewer",
                           SDL_WINDOWPOS_UNDEFINED_DISPLAY(display_nr),
                           SDL_WINDOWPOS_UNDEFINED_DISPLAY(display_nr),
                           create_w, create_h,
                           (full_screen ? SDL_WINDOW_FULLSCREEN : 0) | SDL_WINDOW_OPENGL);
-	assert(win);
+		assert(win);
 
-	SDL_Renderer *screen = SDL_CreateRenderer(win, -1, 0);
-	assert(screen);
+		screen = SDL_CreateRenderer(win, -1, 0);
+		assert(screen);
+
+		SDL_GetWindowSize(win, &w, &h);
+	}
 
-	int w = 0;
-	int h = 0;
-	SDL_GetWindowSize(win, &w, &h);
 	printf("%dx%d\n", w, h);
 
 	const int xsteps = w / n_columns;
 	const int ysteps = h / n_rows;
 	screen_descriptor_t sd { screen, w, h, xsteps, ysteps };
 
-	if (full_screen)
+	if (full_screen && !headless)
 		SDL_ShowCursor(SDL_DISABLE);
 
+	set_texture_budget(uint64_t(texture_budget_mb) * 1024 * 1024);
+
 	std::vector<container_t> containers;
 	std::vector<feed *>      feeds;
 
-	const libconfig::Setting & instances   = root["instances"];
-	size_t                     n_instances = instances.getLength();
-
-	for(size_t i=0; i<n_instances; i++) {
-		const libconfig::Setting & instance = instances[i];
-
-		std::string formatter_type = cfg_str(instance, "formatter", "json, text, value or as-is", false, "as-is");
-		base_text_formatter *tf { nullptr };
+	create_instances(root, &sd, &containers, &feeds, replay_file.empty() == false);
 
-		std::string format_string;
+	recorder *rec = nullptr;
+	if (record_file.empty() == false) {
+		rec = new recorder(record_file);
 
-		if (formatter_type == "json") {
-			std::string format_string = cfg_str(instance, "format-string", "json", false, "");
+		for(size_t i=0; i<feeds.size(); i++)
+			feeds.at(i)->set_recorder(rec, i);
+	}
 
-			tf = new json_formatter(format_string);
-		}
-		else if (formatter_type == "as-is") {
-			tf = new text_formatter({ });
-		}
-		else if (formatter_type == "text") {
-			std::string format_string = cfg_str(instance, "format-string", "text", false, "");
+	// without a display, stop when the recording has been played
+	replayer *rep = nullptr;
+	if (replay_file.empty() == false)
+		rep = new replayer(replay_file, feeds, replay_speed, headless);
 
-			tf = new text_formatter(format_string);
-		}
-		else if (formatter_type == "value") {
-			int n_digits = cfg_int(instance, "n-digits", "number of digits (0 for integer)", false, 0);
-
-			tf = new value_formatter(n_digits);
-		}
-		else {
-			error_exit(false, "\"format-string %s\" unknown", formatter_type.c_str());
-		}
+	uint64_t n_frames     = 0;
+	uint64_t n_draw_calls = 0;
 
-		container *c { nullptr };
+	background bg(grid, n_columns, n_rows);
 
-		std::string font = cfg_str(instance, "font", "path to font", false, "/usr/share/vlc/skins2/fonts/FreeSans.ttf");
-		double font_height = cfg_float(instance, "font-height", "font height", false, 5.0);
+	profiler prof(containers, stats_file, stats_interval, overlay_font, overlay_font_height, headless);
 
-		int max_width = cfg_int(instance, "max-width", "max text width", false, 5);
+	metrics met(containers, feeds, metrics_file, metrics_interval, metrics_listen, metrics_port);
 
-		int clear_after = cfg_int(instance, "clear-after", "clear text after (in seconds)", true, -1);
+	uint64_t run_start_us     = get_us();
+	time_t   next_snapshot    = snapshot_interval > 0 ? time(nullptr) + snapshot_interval : 0;
 
-		std::string color = cfg_str(instance, "fg-color", "r,g,b triple", true, "255,0,0");
-		std::vector<std::string> color_str = split(color, ",");
-		int fg_r = atoi(color_str.at(0).c_str());
-		int fg_g = atoi(color_str.at(1).c_str());
-		int fg_b = atoi(color_str.at(2).c_str());
+	while(!do_exit) {
+		if (max_frames > 0 && n_frames >= max_frames)
+			break;
 
-		std::string bg_color = cfg_str(instance, "bg-color", "r,g,b triple", true, "255,0,0");
-		std::vector<std::string> bg_color_str = split(bg_color, ",");
-		int bg_r = atoi(bg_color_str.at(0).c_str());
-		int bg_g = atoi(bg_color_str.at(1).c_str());
-		int bg_b = atoi(bg_color_str.at(2).c_str());
+		if (max_seconds > 0 && get_us() - run_start_us >= max_seconds * uint64_t(1000000))
+			break;
 
-		std::string b_color = cfg_str(instance, "b-color", "r,g,b triple", true, "255,0,0");
-		std::vector<std::string> b_color_str = split(b_color, ",");
-		int b_r = atoi(b_color_str.at(0).c_str());
-		int b_g = atoi(b_color_str.at(1).c_str());
-		int b_b = atoi(b_color_str.at(2).c_str());
+		prof.start_frame();
 
-		bool bg_fill = cfg_bool(instance, "bg-fill", "fill background", true, true);
+		int frame_draw_calls = draw_frame(&sd, &bg, containers, &prof);
 
-		int x = cfg_int(instance, "x", "x position", false, 0);
-		int y = cfg_int(instance, "y", "y position", false, 0);
-		int w = cfg_int(instance, "w", "w position", false, 1);
-		int h = cfg_int(instance, "h", "h position", false, 1);
+		frame_draw_calls += prof.put_overlay(&sd);
 
-		bool center_h = cfg_bool(instance, "center-horizontal", "center horizontal", true, true);
-		bool center_v = cfg_bool(instance, "center-vertical",   "center vertical",   true, true);
+		if (snapshot_dir.empty() == false && (snapshot_requested.exchange(false) || (next_snapshot && time(nullptr) >= next_snapshot))) {
+			std::string file = myformat("%s/infoviewer-%06lu.png", snapshot_dir.c_str(), n_frames);
 
-		container_type_t ct;
+			if (save_snapshot(screen, file))
+				printf("snapshot written to %s\n", file.c_str());
 
-		std::string type = cfg_str(instance, "type", "scroller or static", false, "static");
-		if (type == "static") {
-			ct = ct_static;
-			c = new text_box(screen, font, ysteps * font_height, fg_r, fg_g, fg_b, max_width * xsteps, tf, clear_after);
+			if (next_snapshot)
+				next_snapshot = time(nullptr) + snapshot_interval;
 		}
-		else if (type == "scroller") {
-			ct = ct_scroller;
-			int scroll_speed = cfg_int(instance, "scroll-speed", "pixel count", true, 1);
-			c = new scroller(screen, font, scroll_speed, ysteps * font_height, fg_r, fg_g, fg_b, max_width * xsteps, tf, clear_after, center_v);
-		}
-		else {
-			error_exit(false, "\"type %s\" unknown", type.c_str());
-		}
-
-		container_t entry { 0 };
-		entry.c        = c;
-		entry.ct       = ct;
-		entry.font_r   = fg_r;
-		entry.font_g   = fg_g;
-		entry.font_b   = fg_b;
-		entry.bg_r     = bg_r;
-		entry.bg_g     = bg_g;
-		entry.bg_b     = bg_b;
-		entry.b_r      = b_r;
-		entry.b_g      = b_g;
-		entry.b_b      = b_b;
-		entry.bg_fill  = bg_fill;
-		entry.x        = x;
-		entry.y        = y;
-		entry.w        = w;
-		entry.h        = h;
-		entry.border   = cfg_bool(instance, "border", "border", false, true);
-		entry.center_h = center_h;
-		entry.center_v = center_v;
-
-		containers.push_back(entry);
-
-		const libconfig::Setting & s_feed = instance["feed"];
-		std::string feed_type = cfg_str(s_feed, "feed-type", "mqtt, exec, tail or static", false, "mqtt");
-
-		feed *f { nullptr };
-
-		if (feed_type == "mqtt") {
-			std::string host = cfg_str(s_feed, "host", "mqtt host", false, "127.0.0.1");
-			int         port = cfg_int(s_feed, "port", "mqtt port", true, 1883);
-
-			const libconfig::Setting & s_topics = s_feed["topics"];
-			size_t n_topics = s_topics.getLength();
-
-			std::vector<std::string> topics;
-
-			for(size_t i=0; i<n_topics; i++) {
-				const libconfig::Setting & s_topic = s_topics[i];
-
-				std::string topic = cfg_str(s_topic, "topic", "mqtt topic", false, "#");
-
-				topics.push_back(topic);
-			}
 
-			f = new mqtt_feed(host, port, topics, c);
-		}
-		else if (feed_type == "exec") {
-			std::string cmd = cfg_str(s_feed, "cmd", "command to invoke", false, "date");
-			int interval = cfg_int(s_feed, "interval", "exec interval (in millisecons)", true, 1000);
-
-			f = new exec_feed(cmd, interval, c);
-		}
-		else if (feed_type == "tail") {
-			std::string cmd = cfg_str(s_feed, "cmd", "command to \"tail\"", false, "tail -f /var/log/messages");
-
-			f = new tail_feed(cmd, c);
-		}
-		else if (feed_type == "static") {
-			std::string text = cfg_str(s_feed, "text", "text to display", false, "my text");
-
-			f = new static_feed(text, c);
+		uint64_t start_us = get_us();
+		{
+			TRACE_SPAN("present");
+			SDL_RenderPresent(screen);
 		}
-		else if (feed_type == "mjpeg") {
-			std::string url = cfg_str(s_feed, "url", "MJPEG url", false, "my url");
+		prof.add_present(get_us() - start_us);
 
-			f = new mjpeg_feed(url, c);
-		}
-		else {
-			error_exit(false, "\"feed-type %s\" unknown", feed_type.c_str());
-		}
+		met.presented();
 
-		feeds.push_back(f);
-	}
+		prof.end_frame(screen, frame_draw_calls);
 
-	while(!do_exit) {
-		if (grid) {
-			for(int cy=0; cy<n_rows; cy++)
-				lineRGBA(screen, 0, cy * ysteps, w, cy * ysteps, 255, 255, 255, 255);
+		enforce_texture_budget();
 
-			for(int cx=0; cx<n_columns; cx++)
-				lineRGBA(screen, cx * xsteps, 0, cx * xsteps, h, 255, 255, 255, 255);
-		}
+		release_textures();
 
-		for(auto & c : containers) {
-			if (c.bg_fill)
-				draw_box(&sd, c.x, c.y, c.w, c.h, c.border, c.bg_r, c.bg_g, c.bg_b, c.b_r, c.b_g, c.b_b);
-
-			if (c.ct == ct_static)		
-				c.c->put_static(&sd, c.x, c.y, c.w, c.h, c.center_h, c.center_v);
-			else if (c.ct == ct_scroller)
-				c.c->put_scroller(&sd, c.x, c.y, c.w, c.h);
-			else
-				error_exit(false, "Internal error: unknown container type %d", c.ct);
-		}
-
-		SDL_RenderPresent(screen);
+		n_draw_calls += frame_draw_calls;
+		n_frames++;
 
 		SDL_Delay(10);
 
@@ -434,13 +361,41 @@ int main(int argc, char *argv[])
 				break;
 			}
 
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p)
+				prof.toggle_overlay();
+
 			if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_RESIZED) {
 				SDL_SetRenderDrawColor(screen, 0, 0, 0, 255);
 				SDL_RenderClear(screen);
+
+				bg.invalidate();
 			}
 		}
 	}
 
+	if (n_frames)
+		printf("%.2f draw calls per frame\n", n_draw_calls / double(n_frames));
+
+	if (headless)
+		prof.print_summary(stdout);
+
+	// feed threads may still be running: the recorder is closed, not deleted
+	if (rec)
+		rec->close();
+
+	do_exit = true;
+
+	delete rep;
+
+#ifdef WITH_TRACE
+	if (trace_file.empty() == false) {
+		if (trace_write(trace_file))
+			printf("trace written to %s\n", trace_file.c_str());
+		else
+			fprintf(stderr, "Cannot write trace to %s\n", trace_file.c_str());
+	}
+#endif
+
 	mosquitto_lib_cleanup();
 
 	return 0;
@@ -0,0 +1,238 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "container.h"
+#include "error.h"
+#include "feeds.h"
+#include "io.h"
+#include "metrics.h"
+#include "str.h"
+#include "texture_budget.h"
+#include "timing.h"
+
+
+extern std::atomic_bool do_exit;
+
+extern void set_thread_name(const std::string & name);
+
+metrics::metrics(const std::vector<container_t> & containers, const std::vector<feed *> & feeds, const std::string & file, const int interval, const std::string & listen_addr, const int port) :
+	containers(containers), feeds(feeds),
+	file(file), interval(std::max(1, interval)),
+	listen_addr(listen_addr), port(port)
+{
+	if (port > 0) {
+		listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (listen_fd == -1)
+			error_exit(true, "metrics: cannot create socket");
+
+		int reuse = 1;
+		setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+
+		struct sockaddr_in addr { };
+		addr.sin_family = AF_INET;
+		addr.sin_port   = htons(port);
+
+		if (inet_pton(AF_INET, listen_addr.c_str(), &addr.sin_addr) != 1)
+			error_exit(false, "metrics: \"%s\" is not a valid IPv4 address", listen_addr.c_str());
+
+		if (bind(listen_fd, reinterpret_cast<const struct sockaddr *>(&addr), sizeof addr) == -1)
+			error_exit(true, "metrics: cannot bind to %s:%d", listen_addr.c_str(), port);
+
+		if (listen(listen_fd, 5) == -1)
+			error_exit(true, "metrics: listen failed");
+	}
+
+	if (port > 0 || file.empty() == false)
+		th = new std::thread(std::ref(*this));
+}
+
+metrics::~metrics()
+{
+	if (th) {
+		th->join();
+		delete th;
+	}
+
+	if (listen_fd != -1)
+		close(listen_fd);
+}
+
+void metrics::presented()
+{
+	uint64_t now_us = get_us();
+
+	for(auto & c : containers)
+		c.c->presented(now_us);
+
+	n_frames++;
+}
+
+static std::string escape_label(const std::string & in)
+{
+	std::string out;
+
+	for(auto c : in) {
+		if (c == '\\' || c == '"')
+			out += '\\';
+
+		if (c == '\n')
+			out += "\\n";
+		else
+			out += c;
+	}
+
+	return out;
+}
+
+std::string metrics::render()
+{
+	std::vector<container_timings_t> timings;
+	for(auto & c : containers)
+		timings.push_back(c.c->get_timings());
+
+	std::string out;
+
+	out += "# HELP infoviewer_frames_total Frames presented.\n";
+	out += "# TYPE infoviewer_frames_total counter\n";
+	out += myformat("infoviewer_frames_total %lu\n", n_frames.load());
+
+	auto family = [&](const char *const name, const char *const type, const char *const help, auto value) {
+		out += myformat("# HELP %s %s\n", name, help);
+		out += myformat("# TYPE %s %s\n", name, type);
+
+		for(size_t i=0; i<containers.size(); i++)
+			out += myformat("%s{instance=\"%s\"} %s\n", name, escape_label(containers.at(i).name).c_str(), value(i).c_str());
+	};
+
+	family("infoviewer_messages_received_total", "counter", "Messages, lines or frames received by the feed.",
+			[&](const size_t i) { return myformat("%lu", feeds.at(i)->get_n_received()); });
+	family("infoviewer_updates_total", "counter", "Updates offered to the container.",
+			[&](const size_t i) { return myformat("%lu", timings.at(i).n_updates); });
+	family("infoviewer_updates_unchanged_total", "counter", "Updates skipped because the text did not change.",
+			[&](const size_t i) { return myformat("%lu", timings.at(i).n_unchanged); });
+	family("infoviewer_update_seconds_total", "counter", "Time spent processing updates.",
+			[&](const size_t i) { return myformat("%.6f", timings.at(i).update_us / 1000000.); });
+	family("infoviewer_format_seconds_total", "counter", "Time spent in the formatter.",
+			[&](const size_t i) { return myformat("%.6f", timings.at(i).format_us / 1000000.); });
+	family("infoviewer_rasterize_seconds_total", "counter", "Time spent rasterizing text and uploading textures.",
+			[&](const size_t i) { return myformat("%.6f", timings.at(i).raster_us / 1000000.); });
+	family("infoviewer_cache_hits_total", "counter", "Texts shown from the texture cache.",
+			[&](const size_t i) { return myformat("%lu", timings.at(i).cache.n_hits); });
+	family("infoviewer_cache_misses_total", "counter", "Texts that had to be rasterized.",
+			[&](const size_t i) { return myformat("%lu", timings.at(i).cache.n_misses); });
+	family("infoviewer_cache_bytes", "gauge", "Approximate texture memory held by the texture cache.",
+			[&](const size_t i) { return myformat("%lu", timings.at(i).cache.bytes); });
+	family("infoviewer_last_update_timestamp_seconds", "gauge", "Wall clock time of the most recent content change.",
+			[&](const size_t i) { return myformat("%ld", long(timings.at(i).last_update)); });
+
+	out += "# HELP infoviewer_texture_bytes Approximate texture memory in use.\n";
+	out += "# TYPE infoviewer_texture_bytes gauge\n";
+
+	for(size_t i=0; i<containers.size(); i++) {
+		std::string label = escape_label(containers.at(i).name);
+
+		for(int t=0; t<n_texture_types; t++)
+			out += myformat("infoviewer_texture_bytes{instance=\"%s\",type=\"%s\"} %lu\n", label.c_str(), texture_type_names[t], timings.at(i).texture_bytes[t]);
+	}
+
+	out += "# HELP infoviewer_texture_budget_bytes Texture memory budget (0 for no limit).\n";
+	out += "# TYPE infoviewer_texture_budget_bytes gauge\n";
+	out += myformat("infoviewer_texture_budget_bytes %lu\n", get_texture_budget());
+
+	const char *const name = "infoviewer_update_to_present_seconds";
+	out += myformat("# HELP %s Latency from the arrival of data to the first frame that shows it.\n", name);
+	out += myformat("# TYPE %s histogram\n", name);
+
+	for(size_t i=0; i<containers.size(); i++) {
+		std::string label = escape_label(containers.at(i).name);
+		const container_timings_t & t = timings.at(i);
+
+		uint64_t cumulative = 0;
+
+		for(size_t b=0; b<n_latency_buckets; b++) {
+			cumulative += t.latency_hist[b];
+
+			out += myformat("%s_bucket{instance=\"%s\",le=\"%g\"} %lu\n", name, label.c_str(), latency_bucket_us[b] / 1000000., cumulative);
+		}
+
+		out += myformat("%s_bucket{instance=\"%s\",le=\"+Inf\"} %lu\n", name, label.c_str(), t.n_latency);
+		out += myformat("%s_sum{instance=\"%s\"} %.6f\n", name, label.c_str(), t.latency_us / 1000000.);
+		out += myformat("%s_count{instance=\"%s\"} %lu\n", name, label.c_str(), t.n_latency);
+	}
+
+	return out;
+}
+
+// replaced atomically so that a reader never sees a partial file
+void metrics::write_file()
+{
+	std::string temp_file = file + ".tmp";
+
+	FILE *fh = fopen(temp_file.c_str(), "w");
+	if (!fh) {
+		fprintf(stderr, "metrics: cannot create %s\n", temp_file.c_str());
+		return;
+	}
+
+	std::string data = render();
+	fwrite(data.c_str(), 1, data.size(), fh);
+	fclose(fh);
+
+	if (rename(temp_file.c_str(), file.c_str()) == -1)
+		fprintf(stderr, "metrics: cannot rename %s to %s\n", temp_file.c_str(), file.c_str());
+}
+
+// whatever was requested, the reply is always the metrics
+void metrics::handle_client(const int fd)
+{
+	struct pollfd fds[] { { fd, POLLIN, 0 } };
+
+	char request[4096];
+	if (poll(fds, 1, 1000) == 1)
+		(void)read(fd, request, sizeof request);
+
+	std::string body  = render();
+	std::string reply = myformat("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", body.size()) + body;
+
+	WRITE(fd, reinterpret_cast<const uint8_t *>(reply.c_str()), reply.size());
+
+	close(fd);
+}
+
+void metrics::operator()()
+{
+	set_thread_name("metrics");
+
+	time_t next_write = 0;
+
+	while(!do_exit) {
+		if (file.empty() == false && time(nullptr) >= next_write) {
+			write_file();
+
+			next_write = time(nullptr) + interval;
+		}
+
+		if (listen_fd == -1) {
+			usleep(500000);
+			continue;
+		}
+
+		struct pollfd fds[] { { listen_fd, POLLIN, 0 } };
+
+		if (poll(fds, 1, 500) == 1) {
+			int fd = accept(listen_fd, nullptr, nullptr);
+
+			if (fd != -1)
+				handle_client(fd);
+		}
+	}
+}
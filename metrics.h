@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "container.h"
+#include "feeds.h"
+
+
+// Per instance counters in the Prometheus text format: written to a file
+// and/or served over HTTP.
+class metrics
+{
+private:
+	const std::vector<container_t> & containers;
+	const std::vector<feed *>      & feeds;
+
+	const std::string    file;
+	const int            interval;
+	const std::string    listen_addr;
+	const int            port;
+
+	int                  listen_fd { -1      };
+	std::thread         *th        { nullptr };
+
+	std::atomic_uint64_t n_frames  { 0       };
+
+	std::string render();
+	void        write_file();
+	void        handle_client(const int fd);
+
+public:
+	metrics(const std::vector<container_t> & containers, const std::vector<feed *> & feeds, const std::string & file, const int interval, const std::string & listen_addr, const int port);
+	virtual ~metrics();
+
+	// to be invoked right after each SDL_RenderPresent
+	void presented();
+
+	void operator()();
+};
@@ -1,5 +1,6 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <pty.h>
 #include <stdlib.h>
 #include <string>
@@ -15,6 +16,7 @@
 #include "error.h"
 #include "io.h"
 #include "str.h"
+#include "trace.h"
 
 
 // this code needs more error checking TODO
@@ -114,3 +116,17 @@ std::tuple<pid_t, int, int> exec_with_pipe(const std::string & command, const st
 
         return out;
 }
+
+void set_thread_name(const std::string & name)
+{
+	std::string full_name = "IV:" + name;
+
+	if (full_name.length() > 15)
+		full_name = full_name.substr(0, 15);
+
+	pthread_setname_np(pthread_self(), full_name.c_str());
+
+#ifdef WITH_TRACE
+	trace_thread_name(name);
+#endif
+}
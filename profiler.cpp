@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "container.h"
+#include "profiler.h"
+#include "str.h"
+#include "texture_budget.h"
+#include "timing.h"
+
+
+extern std::mutex ttf_lock;
+
+profiler::profiler(const std::vector<container_t> & containers, const std::string & stats_file, const int stats_interval, const std::string & overlay_font_file, const int overlay_font_height, const bool track_run) :
+	containers(containers),
+	stats_file(stats_file), stats_interval(std::max(1, stats_interval)),
+	overlay_font_file(overlay_font_file), overlay_font_height(overlay_font_height)
+{
+	if (stats_file.empty() == false) {
+		fh = fopen(stats_file.c_str(), "a");
+
+		if (!fh)
+			fprintf(stderr, "Cannot open statistics file %s\n", stats_file.c_str());
+	}
+
+	periods = { &overlay_period, &file_period };
+
+	if (track_run)
+		periods.push_back(&run_period);
+
+	for(auto p : periods)
+		start_period(p);
+}
+
+profiler::~profiler()
+{
+	for(auto & l : overlay_lines)
+		SDL_DestroyTexture(l.first);
+
+	if (overlay_font) {
+		ttf_lock.lock();
+		TTF_CloseFont(overlay_font);
+		ttf_lock.unlock();
+	}
+
+	if (fh)
+		fclose(fh);
+}
+
+static size_t frame_bucket(const uint32_t us)
+{
+	if (us < 10000)
+		return us / 10;
+
+	return std::min(n_frame_buckets - 1, size_t(1000 + (us - 10000) / 1000));
+}
+
+static uint32_t bucket_start_us(const size_t b)
+{
+	if (b < 1000)
+		return b * 10;
+
+	return 10000 + (b - 1000) * 1000;
+}
+
+void profiler::start_period(period_t *const p)
+{
+	p->start_us      = get_us();
+	p->n_frames      = 0;
+	p->frame_hist.assign(n_frame_buckets, 0);
+	p->frame_max_us  = 0;
+	p->background_us = 0;
+	p->present_us    = 0;
+	p->draw_calls    = 0;
+
+	p->draw_us.assign(containers.size(), 0);
+
+	p->feed_start.clear();
+	for(auto & c : containers)
+		p->feed_start.push_back(c.c->get_timings());
+}
+
+void profiler::toggle_overlay()
+{
+	show_overlay = !show_overlay;
+
+	if (show_overlay && !overlay_font) {
+		ttf_lock.lock();
+		overlay_font = TTF_OpenFont(overlay_font_file.c_str(), overlay_font_height);
+		ttf_lock.unlock();
+
+		if (!overlay_font) {
+			fprintf(stderr, "overlay font %s can't be loaded: %s\n", overlay_font_file.c_str(), TTF_GetError());
+
+			show_overlay = false;
+		}
+	}
+}
+
+void profiler::start_frame()
+{
+	frame_start_us = get_us();
+}
+
+void profiler::add_background(const uint64_t us)
+{
+	for(auto p : periods)
+		p->background_us += us;
+}
+
+void profiler::add_container(const size_t nr, const uint64_t us)
+{
+	for(auto p : periods)
+		p->draw_us.at(nr) += us;
+}
+
+void profiler::add_present(const uint64_t us)
+{
+	for(auto p : periods)
+		p->present_us += us;
+}
+
+void profiler::end_frame(SDL_Renderer *const renderer, const int draw_calls)
+{
+	uint64_t now  = get_us();
+	uint32_t took = now - frame_start_us;
+
+	for(auto p : periods) {
+		p->n_frames++;
+		p->frame_hist.at(frame_bucket(took))++;
+		p->frame_max_us = std::max(p->frame_max_us, took);
+		p->draw_calls += draw_calls;
+	}
+
+	if (now - overlay_period.start_us >= 1000000 || (show_overlay && overlay_lines.empty())) {
+		if (show_overlay)
+			update_overlay(renderer, summarize(overlay_period));
+
+		start_period(&overlay_period);
+	}
+
+	if (fh && now - file_period.start_us >= stats_interval * uint64_t(1000000)) {
+		write_stats(summarize(file_period));
+
+		start_period(&file_period);
+	}
+}
+
+frame_summary_t profiler::summarize(const period_t & p)
+{
+	frame_summary_t s { };
+
+	double elapsed  = (get_us() - p.start_us) / 1000000.0;
+	double n_frames = std::max(uint64_t(1), p.n_frames);
+
+	s.fps           = elapsed > 0 ? p.n_frames / elapsed : 0.;
+	s.background_ms = p.background_us / n_frames / 1000.;
+	s.present_ms    = p.present_us    / n_frames / 1000.;
+	s.draw_calls    = p.draw_calls    / n_frames;
+
+	// the lower bound of the bucket that holds the q-th frame
+	auto percentile = [&p](const double q) {
+		if (p.n_frames == 0)
+			return 0.;
+
+		uint64_t target     = std::min(p.n_frames - 1, uint64_t(p.n_frames * q));
+		uint64_t cumulative = 0;
+
+		for(size_t b=0; b<n_frame_buckets; b++) {
+			cumulative += p.frame_hist.at(b);
+
+			if (cumulative > target)
+				return bucket_start_us(b) / 1000.;
+		}
+
+		return p.frame_max_us / 1000.;
+	};
+
+	s.frame_p50_ms = percentile(0.50);
+	s.frame_p95_ms = percentile(0.95);
+	s.frame_p99_ms = percentile(0.99);
+	s.frame_max_ms = p.frame_max_us / 1000.;
+
+	s.texture_bytes = get_texture_bytes();
+
+	for(size_t i=0; i<containers.size(); i++) {
+		container_timings_t now   = containers.at(i).c->get_timings();
+		const container_timings_t & start = p.feed_start.at(i);
+
+		uint64_t n_updates = now.n_updates - start.n_updates;
+		double   divider   = std::max(uint64_t(1), n_updates) * 1000.;
+
+		container_summary_t cs { };
+		cs.draw_ms   = p.draw_us.at(i) / n_frames / 1000.;
+		cs.update_ms = (now.update_us - start.update_us) / divider;
+		cs.format_ms = (now.format_us - start.format_us) / divider;
+		cs.n_updates = n_updates;
+
+		for(int t=0; t<n_texture_types; t++)
+			cs.texture_bytes += now.texture_bytes[t];
+
+		s.containers.push_back(cs);
+	}
+
+	return s;
+}
+
+void profiler::update_overlay(SDL_Renderer *const renderer, const frame_summary_t & s)
+{
+	std::vector<std::string> lines;
+
+	lines.push_back(myformat("%.1f fps, frame p50/p95/p99/max: %.2f/%.2f/%.2f/%.2f ms", s.fps, s.frame_p50_ms, s.frame_p95_ms, s.frame_p99_ms, s.frame_max_ms));
+	lines.push_back(myformat("background %.2f ms, present %.2f ms, %.1f draw calls", s.background_ms, s.present_ms, s.draw_calls));
+
+	for(size_t i=0; i<containers.size(); i++) {
+		const container_summary_t & cs = s.containers.at(i);
+
+		lines.push_back(myformat("%s: draw %.3f ms, %lu updates of %.2f ms (format %.2f ms)", containers.at(i).name.c_str(), cs.draw_ms, cs.n_updates, cs.update_ms, cs.format_ms));
+	}
+
+	for(auto & l : overlay_lines)
+		SDL_DestroyTexture(l.first);
+	overlay_lines.clear();
+
+	SDL_Color col { 255, 255, 255, 255 };
+	int       y   = 0;
+
+	// overlay_font is only used by the render thread
+	for(auto & line : lines) {
+		SDL_Surface *surface = TTF_RenderUTF8_Blended(overlay_font, line.c_str(), col);
+		if (!surface)
+			continue;
+
+		SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+		if (texture)
+			overlay_lines.push_back({ texture, { 0, y, surface->w, surface->h } });
+
+		y += surface->h;
+
+		SDL_FreeSurface(surface);
+	}
+}
+
+int profiler::put_overlay(screen_descriptor_t *const sd)
+{
+	if (!show_overlay || overlay_lines.empty())
+		return 0;
+
+	SDL_Rect area { 0, 0, 0, 0 };
+	for(auto & l : overlay_lines) {
+		area.w = std::max(area.w, l.second.w);
+		area.h = l.second.y + l.second.h;
+	}
+
+	SDL_SetRenderDrawBlendMode(sd->screen, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(sd->screen, 0, 0, 0, 191);
+	SDL_RenderFillRect(sd->screen, &area);
+
+	for(auto & l : overlay_lines)
+		SDL_RenderCopy(sd->screen, l.first, nullptr, &l.second);
+
+	return 1 + overlay_lines.size();
+}
+
+static std::string json_escape(const std::string & in)
+{
+	std::string out;
+
+	for(auto c : in) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+
+		out += c;
+	}
+
+	return out;
+}
+
+// one json object per line
+void profiler::write_stats(const frame_summary_t & s)
+{
+	fprintf(fh, "{\"time\":%ld,\"fps\":%.2f,\"frame_p50_ms\":%.3f,\"frame_p95_ms\":%.3f,\"frame_p99_ms\":%.3f,\"frame_max_ms\":%.3f,\"background_ms\":%.3f,\"present_ms\":%.3f,\"draw_calls\":%.2f,\"texture_bytes\":%lu,\"containers\":[",
+			long(time(nullptr)), s.fps, s.frame_p50_ms, s.frame_p95_ms, s.frame_p99_ms, s.frame_max_ms, s.background_ms, s.present_ms, s.draw_calls, s.texture_bytes);
+
+	for(size_t i=0; i<containers.size(); i++) {
+		const container_summary_t & cs = s.containers.at(i);
+
+		fprintf(fh, "%s{\"name\":\"%s\",\"draw_ms\":%.3f,\"updates\":%lu,\"update_ms\":%.3f,\"format_ms\":%.3f,\"texture_bytes\":%lu}",
+				i ? "," : "", json_escape(containers.at(i).name).c_str(), cs.draw_ms, cs.n_updates, cs.update_ms, cs.format_ms, cs.texture_bytes);
+	}
+
+	fprintf(fh, "]}\n");
+	fflush(fh);
+}
+
+void profiler::print_summary(FILE *const fh)
+{
+	frame_summary_t s = summarize(run_period);
+
+	fprintf(fh, "%lu frames, %.1f fps\n", run_period.n_frames, s.fps);
+	fprintf(fh, "frame time p50/p95/p99/max: %.3f/%.3f/%.3f/%.3f ms\n", s.frame_p50_ms, s.frame_p95_ms, s.frame_p99_ms, s.frame_max_ms);
+	fprintf(fh, "background %.3f ms, present %.3f ms, %.1f draw calls per frame\n", s.background_ms, s.present_ms, s.draw_calls);
+	fprintf(fh, "texture memory %.1f MB (budget: %.1f MB)\n", s.texture_bytes / 1048576., get_texture_budget() / 1048576.);
+
+	for(size_t i=0; i<containers.size(); i++) {
+		const container_summary_t & cs = s.containers.at(i);
+
+		fprintf(fh, "%s: draw %.3f ms, %lu updates of %.3f ms (format %.3f ms)\n", containers.at(i).name.c_str(), cs.draw_ms, cs.n_updates, cs.update_ms, cs.format_ms);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "container.h"
+
+
+typedef struct {
+	double draw_ms;    // per frame
+	double update_ms;  // per set_text/set_pixels (feed thread)
+	double format_ms;  // per set_text (feed thread)
+	uint64_t n_updates;
+	uint64_t texture_bytes;  // at the end of the period
+} container_summary_t;
+
+typedef struct {
+	double fps;
+	double frame_p50_ms, frame_p95_ms, frame_p99_ms, frame_max_ms;
+	double background_ms;
+	double present_ms;
+	double draw_calls;
+	uint64_t texture_bytes;  // of all containers
+	std::vector<container_summary_t> containers;
+} frame_summary_t;
+
+// frame times: 10 us resolution up to 10 ms, then 1 ms up to 1 s
+constexpr const size_t n_frame_buckets = 1000 + 990 + 1;
+
+// Measures where the time of each frame goes. The results are shown in an
+// overlay (when enabled) and periodically appended to a file.
+class profiler
+{
+private:
+	typedef struct {
+		uint64_t start_us;
+		uint64_t n_frames;
+		std::vector<uint32_t> frame_hist;  // render times, see frame_bucket()
+		uint32_t frame_max_us;
+		uint64_t background_us;
+		uint64_t present_us;
+		uint64_t draw_calls;
+		std::vector<uint64_t> draw_us;
+		std::vector<container_timings_t> feed_start;
+	} period_t;
+
+	const std::vector<container_t> & containers;
+
+	const std::string stats_file;
+	const int         stats_interval;
+	FILE             *fh           { nullptr };
+
+	const std::string overlay_font_file;
+	const int         overlay_font_height;
+	TTF_Font         *overlay_font { nullptr };
+	bool              show_overlay { false   };
+	std::vector<std::pair<SDL_Texture *, SDL_Rect> > overlay_lines;
+
+	period_t          overlay_period;
+	period_t          file_period;
+	period_t          run_period;  // only filled when track_run is set
+	std::vector<period_t *> periods;
+
+	uint64_t          frame_start_us { 0 };
+
+	void            start_period(period_t *const p);
+	frame_summary_t summarize   (const period_t & p);
+	void            update_overlay(SDL_Renderer *const renderer, const frame_summary_t & s);
+	void            write_stats (const frame_summary_t & s);
+
+public:
+	profiler(const std::vector<container_t> & containers, const std::string & stats_file, const int stats_interval, const std::string & overlay_font_file, const int overlay_font_height, const bool track_run);
+	virtual ~profiler();
+
+	void toggle_overlay();
+
+	void start_frame();
+	void add_background(const uint64_t us);
+	void add_container (const size_t nr, const uint64_t us);
+	void add_present   (const uint64_t us);
+	void end_frame     (SDL_Renderer *const renderer, const int draw_calls);
+
+	// returns the number of draw calls issued
+	int put_overlay(screen_descriptor_t *const sd);
+
+	// statistics since startup (requires track_run)
+	void print_summary(FILE *const fh);
+};
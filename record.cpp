@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <unistd.h>
+
+#include "error.h"
+#include "proc.h"
+#include "record.h"
+#include "timing.h"
+
+
+extern std::atomic_bool do_exit;
+
+static const char     magic[]     = "IVREC";
+constexpr const int   rec_version = 1;
+constexpr const char  msg_text    = 'T';
+
+// larger values in a recording can only come from corruption
+constexpr const uint64_t max_string_len = 16 * 1024 * 1024;
+constexpr const uint64_t max_lines      = 65536;
+
+static void put_varint(FILE *const fh, uint64_t v)
+{
+	while(v >= 0x80) {
+		fputc((v & 0x7f) | 0x80, fh);
+		v >>= 7;
+	}
+
+	fputc(int(v), fh);
+}
+
+static bool get_varint(FILE *const fh, uint64_t *const v)
+{
+	*v = 0;
+
+	for(int shift=0; shift<64; shift += 7) {
+		int c = fgetc(fh);
+		if (c == EOF)
+			return false;
+
+		*v |= uint64_t(c & 0x7f) << shift;
+
+		if ((c & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void put_string(FILE *const fh, const std::string & s)
+{
+	put_varint(fh, s.size());
+	fwrite(s.data(), 1, s.size(), fh);
+}
+
+static bool get_string(FILE *const fh, std::string *const s)
+{
+	uint64_t len = 0;
+	if (!get_varint(fh, &len))
+		return false;
+
+	if (len > max_string_len) {
+		fprintf(stderr, "recording is corrupt: string of %" PRIu64 " bytes\n", len);
+		return false;
+	}
+
+	s->resize(len);
+
+	return len == 0 || fread(&(*s)[0], 1, len, fh) == len;
+}
+
+recorder::recorder(const std::string & file)
+{
+	fh = fopen(file.c_str(), "wb");
+	if (!fh)
+		error_exit(true, "Cannot create %s", file.c_str());
+
+	fwrite(magic, 1, strlen(magic), fh);
+	fputc(rec_version, fh);
+
+	prev_us = last_flush_us = get_us();
+}
+
+recorder::~recorder()
+{
+	close();
+}
+
+void recorder::record(const uint32_t instance, const uint64_t arrival_us, const std::string & source, const std::vector<std::string> & lines)
+{
+	lock.lock();
+
+	if (fh) {
+		// feeds run in parallel: arrival times are not strictly increasing
+		uint64_t ts = std::max(arrival_us, prev_us);
+
+		fputc(msg_text, fh);
+		put_varint(fh, instance);
+		put_varint(fh, ts - prev_us);
+		put_string(fh, source);
+
+		put_varint(fh, lines.size());
+		for(auto & line : lines)
+			put_string(fh, line);
+
+		prev_us = ts;
+
+		// limit what is lost when the program is killed
+		if (ts - last_flush_us >= 1000000) {
+			fflush(fh);
+			last_flush_us = ts;
+		}
+	}
+
+	lock.unlock();
+}
+
+void recorder::close()
+{
+	lock.lock();
+
+	if (fh) {
+		fclose(fh);
+		fh = nullptr;
+	}
+
+	lock.unlock();
+}
+
+replayer::replayer(const std::string & file, const std::vector<feed *> & feeds, const double speed, const bool exit_at_end) : feeds(feeds), speed(speed), exit_at_end(exit_at_end)
+{
+	fh = fopen(file.c_str(), "rb");
+	if (!fh)
+		error_exit(true, "Cannot open %s", file.c_str());
+
+	char header[sizeof magic] { 0 };
+	if (fread(header, 1, sizeof header, fh) != sizeof header || memcmp(header, magic, strlen(magic)) != 0)
+		error_exit(false, "%s is not an infoviewer recording", file.c_str());
+
+	if (header[strlen(magic)] != rec_version)
+		error_exit(false, "%s: recording version %d not supported", file.c_str(), header[strlen(magic)]);
+
+	th = new std::thread(std::ref(*this));
+}
+
+replayer::~replayer()
+{
+	th->join();
+	delete th;
+
+	fclose(fh);
+}
+
+bool replayer::read_message(uint32_t *const instance, uint64_t *const delta_us, std::vector<std::string> *const lines)
+{
+	if (fgetc(fh) != msg_text)
+		return false;
+
+	uint64_t    temp    = 0;
+	std::string source;
+	uint64_t    n_lines = 0;
+
+	if (!get_varint(fh, &temp))
+		return false;
+	*instance = temp;
+
+	if (!get_varint(fh, delta_us) || !get_string(fh, &source) || !get_varint(fh, &n_lines))
+		return false;
+
+	if (n_lines > max_lines) {
+		fprintf(stderr, "recording is corrupt: message of %" PRIu64 " lines\n", n_lines);
+		return false;
+	}
+
+	lines->resize(n_lines);
+
+	for(auto & line : *lines) {
+		if (!get_string(fh, &line))
+			return false;
+	}
+
+	return true;
+}
+
+void replayer::operator()()
+{
+	set_thread_name("replay");
+
+	uint64_t next_us    = get_us();
+	uint64_t n_messages = 0;
+	uint64_t n_unknown  = 0;
+
+	uint32_t                 instance = 0;
+	uint64_t                 delta_us = 0;
+	std::vector<std::string> lines;
+
+	// a truncated last message (program was killed while recording) ends the replay
+	while(!do_exit && read_message(&instance, &delta_us, &lines)) {
+		if (speed > 0.) {
+			next_us += uint64_t(delta_us / speed);
+
+			// in steps, recordings can have long pauses
+			for(uint64_t now = get_us(); next_us > now && !do_exit; now = get_us())
+				usleep(std::min(next_us - now, uint64_t(100000)));
+		}
+
+		if (instance >= feeds.size()) {
+			n_unknown++;
+			continue;
+		}
+
+		feeds.at(instance)->publish(lines, get_us());
+
+		n_messages++;
+	}
+
+	printf("replay finished: %" PRIu64 " messages", n_messages);
+	if (n_unknown)
+		printf(", %" PRIu64 " for instances not in the configuration", n_unknown);
+	printf("\n");
+
+	if (exit_at_end)
+		do_exit = true;
+}
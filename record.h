@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "feeds.h"
+
+
+// Binary log of everything that enters the feeds.
+// File: "IVREC" + version byte, then per message:
+//   'T', varint instance, varint microseconds since previous message,
+//   varint source length + source (e.g. mqtt topic),
+//   varint line count, per line varint length + bytes
+class recorder
+{
+private:
+	FILE      *fh            { nullptr };
+	std::mutex lock;
+	uint64_t   prev_us       { 0       };
+	uint64_t   last_flush_us { 0       };
+
+public:
+	recorder(const std::string & file);
+	virtual ~recorder();
+
+	void record(const uint32_t instance, const uint64_t arrival_us, const std::string & source, const std::vector<std::string> & lines);
+
+	// further messages are ignored
+	void close();
+};
+
+// plays a recording back into the feeds, 'speed' times as fast (0: as fast as possible)
+class replayer
+{
+private:
+	FILE                     *fh          { nullptr };
+	const std::vector<feed *> feeds;
+	const double              speed       { 1.      };
+	const bool                exit_at_end { false   };
+	std::thread              *th          { nullptr };
+
+	bool read_message(uint32_t *const instance, uint64_t *const delta_us, std::vector<std::string> *const lines);
+
+public:
+	replayer(const std::string & file, const std::vector<feed *> & feeds, const double speed, const bool exit_at_end);
+	virtual ~replayer();
+
+	void operator()();
+};
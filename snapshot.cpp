@@ -0,0 +1,30 @@
+#include <cstdio>
+#include <string>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+
+// stores what has been drawn so far as a PNG file
+bool save_snapshot(SDL_Renderer *const renderer, const std::string & filename)
+{
+	int w = 0;
+	int h = 0;
+	if (SDL_GetRendererOutputSize(renderer, &w, &h) == -1)
+		return false;
+
+	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (!surface)
+		return false;
+
+	bool ok = SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, surface->pixels, surface->pitch) == 0;
+
+	if (ok && IMG_SavePNG(surface, filename.c_str()) == -1) {
+		fprintf(stderr, "Cannot write %s: %s\n", filename.c_str(), IMG_GetError());
+
+		ok = false;
+	}
+
+	SDL_FreeSurface(surface);
+
+	return ok;
+}
@@ -0,0 +1,5 @@
+#include <string>
+#include <SDL2/SDL.h>
+
+
+bool save_snapshot(SDL_Renderer *const renderer, const std::string & filename);
@@ -0,0 +1,258 @@
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <SDL2/SDL_ttf.h>
+
+#include "text_layout.h"
+
+
+// returns U+FFFD for invalid sequences (also overlong encodings, surrogates
+// and values above U+10FFFF) and then skips only one byte
+uint32_t utf8_decode(const std::string & in, size_t *const pos)
+{
+	const uint8_t c  = in[*pos];
+	int           n  = 0;
+	uint32_t      cp = 0;
+
+	if (c < 0x80) {
+		(*pos)++;
+		return c;
+	}
+
+	if ((c & 0xe0) == 0xc0) {
+		n  = 1;
+		cp = c & 0x1f;
+	}
+	else if ((c & 0xf0) == 0xe0) {
+		n  = 2;
+		cp = c & 0x0f;
+	}
+	else if ((c & 0xf8) == 0xf0) {
+		n  = 3;
+		cp = c & 0x07;
+	}
+	else {
+		(*pos)++;
+		return 0xfffd;
+	}
+
+	for(int i=1; i<=n; i++) {
+		if (*pos + i >= in.size() || (in[*pos + i] & 0xc0) != 0x80) {
+			(*pos)++;
+			return 0xfffd;
+		}
+
+		cp = (cp << 6) | (in[*pos + i] & 0x3f);
+	}
+
+	constexpr const uint32_t min_cp[] = { 0, 0x80, 0x800, 0x10000 };
+
+	if (cp < min_cp[n] || (cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) {
+		(*pos)++;
+		return 0xfffd;
+	}
+
+	*pos += n + 1;
+
+	return cp;
+}
+
+// codepoints that never start a grapheme cluster of their own
+static bool is_extending(const uint32_t cp)
+{
+	return (cp >= 0x0300  && cp <= 0x036f ) ||  // combining diacritical marks
+	       (cp >= 0x1ab0  && cp <= 0x1aff ) ||
+	       (cp >= 0x1dc0  && cp <= 0x1dff ) ||
+	       (cp >= 0x20d0  && cp <= 0x20ff ) ||
+	       (cp >= 0xfe20  && cp <= 0xfe2f ) ||
+	       (cp >= 0xfe00  && cp <= 0xfe0f ) ||  // variation selectors
+	       (cp >= 0xe0100 && cp <= 0xe01ef) ||
+	       (cp >= 0x1f3fb && cp <= 0x1f3ff) ||  // emoji skin tones
+	       (cp >= 0xe0020 && cp <= 0xe007f) ||  // emoji tags
+	        cp == 0x200d;                       // zero width joiner
+}
+
+static bool is_regional_indicator(const uint32_t cp)
+{
+	return cp >= 0x1f1e6 && cp <= 0x1f1ff;
+}
+
+// returns the offset of the first byte after the grapheme cluster that starts at "pos"
+size_t next_grapheme(const std::string & in, const size_t pos)
+{
+	size_t   p     = pos;
+	uint32_t first = utf8_decode(in, &p);
+	uint32_t prev  = first;
+
+	while(p < in.size()) {
+		size_t   q  = p;
+		uint32_t cp = utf8_decode(in, &q);
+
+		if (is_extending(cp) || prev == 0x200d)
+			p = q;
+		else if (is_regional_indicator(first) && is_regional_indicator(cp) && prev == first)
+			p = q;  // flags are pairs of regional indicators
+		else
+			break;
+
+		prev = cp;
+	}
+
+	return p;
+}
+
+text_layout::text_layout(TTF_Font *const font, const bool word_wrap) : font(font), word_wrap(word_wrap)
+{
+}
+
+text_layout::~text_layout()
+{
+}
+
+int text_layout::advance(const uint32_t cp, const std::string & utf8)
+{
+	auto it = advances.find(cp);
+	if (it != advances.end())
+		return it->second;
+
+	int min_x = 0, max_x = 0, min_y = 0, max_y = 0, adv = 0;
+#if SDL_TTF_VERSION_ATLEAST(2, 0, 18)
+	int rc = TTF_GlyphMetrics32(font, cp, &min_x, &max_x, &min_y, &max_y, &adv);
+#else
+	int rc = cp <= 0xffff ? TTF_GlyphMetrics(font, cp, &min_x, &max_x, &min_y, &max_y, &adv) : -1;
+#endif
+
+	if (rc == -1) {  // let SDL_ttf figure out what it will draw instead
+		int dummy = 0;
+
+		if (TTF_SizeUTF8(font, utf8.c_str(), &adv, &dummy) == -1)
+			adv = 0;
+	}
+
+	advances.insert({ cp, adv });
+
+	return adv;
+}
+
+int text_layout::measure_cluster(const std::string & text, const size_t start, const size_t end)
+{
+	int    w   = 0;
+	size_t pos = start;
+
+	while(pos < end) {
+		size_t   cp_start = pos;
+		uint32_t cp       = utf8_decode(text, &pos);
+
+		w += advance(cp, text.substr(cp_start, pos - cp_start));
+	}
+
+	return w;
+}
+
+int text_layout::measure(const std::string & text)
+{
+	lock.lock();
+	int w = measure_cluster(text, 0, text.size());
+	lock.unlock();
+
+	return w;
+}
+
+void text_layout::wrap_line(const std::string & line, const int max_width, std::vector<std::string> *const out)
+{
+	if (max_width <= 0) {
+		out->push_back(line);
+		return;
+	}
+
+	size_t line_start = 0;
+	int    line_w     = 0;
+
+	// most recent word boundary: text before it ends at brk_end, the next
+	// line would start at brk_next and already be brk_w pixels wide
+	size_t brk_end    = std::string::npos;
+	size_t brk_next   = std::string::npos;
+	int    brk_w      = 0;
+
+	size_t pos        = 0;
+
+	while(pos < line.size()) {
+		size_t next  = next_grapheme(line, pos);
+		bool   space = line[pos] == ' ';
+		int    w     = measure_cluster(line, pos, next);
+
+		if (line_w + w > max_width && pos > line_start && (!space || !word_wrap)) {
+			if (word_wrap && brk_next != std::string::npos && brk_end > line_start) {
+				out->push_back(line.substr(line_start, brk_end - line_start));
+
+				line_start = brk_next;
+				line_w     = brk_w;
+			}
+			else {  // no word boundary on this line: break between graphemes
+				out->push_back(line.substr(line_start, pos - line_start));
+
+				line_start = pos;
+				line_w     = 0;
+			}
+
+			brk_next = std::string::npos;
+		}
+
+		if (space && word_wrap) {
+			if (brk_next != pos)
+				brk_end = pos;
+
+			brk_next = next;
+			brk_w    = 0;
+		}
+		else {
+			brk_w += w;
+		}
+
+		line_w += w;
+		pos     = next;
+	}
+
+	if (line_start < line.size() || line.empty())
+		out->push_back(line.substr(line_start));
+}
+
+std::vector<std::string> text_layout::layout(const std::vector<std::string> & in, const int max_width)
+{
+	std::string key;
+	for(auto & line : in)
+		key += line + "\n";
+
+	lock.lock();
+
+	auto it = index.find({ key, max_width });
+	if (it != index.end()) {
+		lru.splice(lru.begin(), lru, it->second);
+
+		std::vector<std::string> out = it->second->second;
+		lock.unlock();
+
+		return out;
+	}
+
+	std::vector<std::string> out;
+	for(auto & line : in)
+		wrap_line(line, max_width, &out);
+
+	lru.push_front({ { key, max_width }, out });
+	index.insert({ { key, max_width }, lru.begin() });
+
+	if (lru.size() > max_cached_layouts) {
+		index.erase(lru.back().first);
+		lru.pop_back();
+	}
+
+	lock.unlock();
+
+	return out;
+}
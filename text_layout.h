@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <SDL2/SDL_ttf.h>
+
+
+// Splits text into lines that fit in a given pixel width. Widths are
+// measured with per-codepoint advances that are retrieved from the font
+// once and then cached.
+// All methods call into SDL_ttf: the caller must hold the lock that
+// serializes the use of the font (container::font_lock).
+class text_layout
+{
+private:
+	TTF_Font  *const font      { nullptr };
+	const bool       word_wrap { true    };
+
+	std::mutex lock;
+	std::unordered_map<uint32_t, int> advances;
+	// least recently used wrapped texts are dropped first; the font is
+	// fixed per text_layout, so the key is the text and the width
+	typedef std::pair<std::pair<std::string, int>, std::vector<std::string> > cache_entry_t;
+	static constexpr const size_t max_cached_layouts = 64;
+	std::list<cache_entry_t> lru;  // most recently used first
+	std::map<std::pair<std::string, int>, std::list<cache_entry_t>::iterator> index;
+
+	int  advance        (const uint32_t cp, const std::string & utf8);
+	int  measure_cluster(const std::string & text, const size_t start, const size_t end);
+	void wrap_line      (const std::string & line, const int max_width, std::vector<std::string> *const out);
+
+public:
+	text_layout(TTF_Font *const font, const bool word_wrap);
+	virtual ~text_layout();
+
+	int measure(const std::string & text);
+
+	std::vector<std::string> layout(const std::vector<std::string> & in, const int max_width);
+};
+
+uint32_t utf8_decode   (const std::string & in, size_t *const pos);
+size_t   next_grapheme (const std::string & in, const size_t pos);
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "texture_budget.h"
+#include "texture_cache.h"
+#include "trace.h"
+
+
+static std::atomic_uint64_t budget      { 0 };
+static std::atomic_uint64_t total_bytes { 0 };
+static std::atomic_bool     over_budget { false };
+
+static std::mutex                   caches_lock;
+static std::vector<texture_cache *> caches;
+
+// to be destroyed by the render thread
+static std::mutex                   released_lock;
+static std::vector<SDL_Texture *>   released;
+
+void set_texture_budget(const uint64_t bytes)
+{
+	budget = bytes;
+}
+
+uint64_t get_texture_budget()
+{
+	return budget;
+}
+
+uint64_t get_texture_bytes()
+{
+	return total_bytes;
+}
+
+void register_texture_cache(texture_cache *const c)
+{
+	trace_lock(caches_lock, "wait caches lock");
+	caches.push_back(c);
+	caches_lock.unlock();
+}
+
+void unregister_texture_cache(texture_cache *const c)
+{
+	trace_lock(caches_lock, "wait caches lock");
+	caches.erase(std::remove(caches.begin(), caches.end(), c), caches.end());
+	caches_lock.unlock();
+}
+
+// the least recently used textures of all caches go first
+void enforce_texture_budget()
+{
+	if (over_budget.exchange(false) == false)
+		return;
+
+	uint64_t limit = budget;
+	if (limit == 0 || total_bytes <= limit)
+		return;
+
+	TRACE_SPAN("evict textures");
+
+	trace_lock(caches_lock, "wait caches lock");
+
+	bool progress = true;
+	while(total_bytes > limit && progress) {
+		progress = false;
+
+		for(auto & c : caches) {
+			if (c->evict_cold())
+				progress = true;
+		}
+	}
+
+	bool over = total_bytes > limit;
+
+	caches_lock.unlock();
+
+	// what is shown can't be evicted
+	static std::atomic_uint64_t n_over { 0 };
+
+	if (over) {
+		uint64_t n = ++n_over;
+
+		report_nth(n, "texture memory (%lu bytes) over budget (%lu bytes), %lu times\n", uint64_t(total_bytes), limit, n);
+	}
+}
+
+texture::texture(texture_account *const account, SDL_Surface *const s, const texture_type_t type) :
+	account(account), type(type), w(s->w), h(s->h), surface(s)
+{
+	account->add(type, get_bytes());
+}
+
+texture::~texture()
+{
+	SDL_FreeSurface(surface);
+
+	if (t) {
+		trace_lock(released_lock, "wait released lock");
+		released.push_back(t);
+		released_lock.unlock();
+	}
+
+	account->remove(type, get_bytes());
+}
+
+SDL_Texture *texture::get(SDL_Renderer *const renderer)
+{
+	if (surface) {
+		TRACE_SPAN("upload texture");
+
+		t = SDL_CreateTextureFromSurface(renderer, surface);
+
+		SDL_FreeSurface(surface);
+		surface = nullptr;
+	}
+
+	return t;
+}
+
+void release_textures()
+{
+	trace_lock(released_lock, "wait released lock");
+	std::vector<SDL_Texture *> work;
+	work.swap(released);
+	released_lock.unlock();
+
+	for(auto t : work)
+		SDL_DestroyTexture(t);
+}
+
+texture_account::texture_account()
+{
+}
+
+texture_account::~texture_account()
+{
+}
+
+void texture_account::add(const texture_type_t type, const uint64_t n)
+{
+	bytes[type] += n;
+	total_bytes += n;
+
+	// evicting is left to the render loop: the textures of other
+	// containers may be in use right now
+	uint64_t limit = budget;
+	if (limit && total_bytes > limit)
+		over_budget = true;
+}
+
+void texture_account::remove(const texture_type_t type, const uint64_t n)
+{
+	bytes[type] -= n;
+	total_bytes -= n;
+}
+
+std::shared_ptr<texture> texture_account::create(SDL_Surface *const s, const texture_type_t type)
+{
+	if (!s)
+		return { };
+
+	return std::make_shared<texture>(this, s, type);
+}
+
+uint64_t texture_account::get_bytes(const texture_type_t type) const
+{
+	return bytes[type];
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <SDL2/SDL.h>
+
+
+typedef enum { tt_text, tt_glyphs, tt_image, n_texture_types } texture_type_t;
+
+constexpr const char *const texture_type_names[n_texture_types] = { "text", "glyphs", "image" };
+
+class texture_account;
+class texture_cache;
+
+// SDL renderers are not thread-safe: only the render thread uses it. A
+// producer hands over what it rasterized and the render thread uploads it
+// the first time it is drawn. Wherever the last reference goes, the
+// SDL_Texture is queued for the render thread to destroy.
+class texture
+{
+private:
+	texture_account *const account;
+	const texture_type_t   type;
+	const int              w, h;
+	SDL_Surface           *surface { nullptr };  // until uploaded
+	SDL_Texture           *t       { nullptr };  // render thread only
+
+public:
+	texture(texture_account *const account, SDL_Surface *const s, const texture_type_t type);
+	virtual ~texture();
+
+	// by the render thread only; nullptr when it can't be created
+	SDL_Texture *get(SDL_Renderer *const renderer);
+
+	int get_w() const { return w; }
+	int get_h() const { return h; }
+
+	// the renderer stores textures with 32 bits per pixel
+	uint64_t get_bytes() const { return uint64_t(w) * h * 4; }
+};
+
+// Texture memory of one container, per type. All textures of a container
+// are created through it. When the total of all containers exceeds the
+// budget, the render loop evicts textures that only a texture_cache still
+// refers to; textures that are shown are never.
+class texture_account
+{
+private:
+	std::atomic_uint64_t bytes[n_texture_types] { };
+
+	friend class texture;
+	void add   (const texture_type_t type, const uint64_t n);
+	void remove(const texture_type_t type, const uint64_t n);
+
+public:
+	texture_account();
+	virtual ~texture_account();
+
+	// takes over s
+	std::shared_ptr<texture> create(SDL_Surface *const s, const texture_type_t type);
+
+	uint64_t get_bytes(const texture_type_t type) const;
+};
+
+// in bytes, 0 for no limit
+void     set_texture_budget(const uint64_t bytes);
+uint64_t get_texture_budget();
+
+// of all containers
+uint64_t get_texture_bytes();
+
+// evicts from the caches when a texture created since the previous call
+// went over the budget; invoked once per frame by the render loop
+void enforce_texture_budget();
+
+// destroys the textures whose last reference went since the previous call;
+// invoked once per frame by the render loop, after enforce_texture_budget()
+void release_textures();
+
+// caches that can give up textures when over budget
+void register_texture_cache  (texture_cache *const c);
+void unregister_texture_cache(texture_cache *const c);
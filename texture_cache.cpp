@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <SDL2/SDL.h>
+
+#include "texture_budget.h"
+#include "texture_cache.h"
+#include "trace.h"
+
+
+// textures are ARGB8888
+static uint64_t entry_bytes(const texture_cache::entry_t & e)
+{
+	return uint64_t(e.w) * e.h * 4;
+}
+
+texture_cache::texture_cache(const size_t max_entries) : max_entries(max_entries)
+{
+	register_texture_cache(this);
+}
+
+texture_cache::~texture_cache()
+{
+	unregister_texture_cache(this);
+}
+
+bool texture_cache::get(const std::string & key, entry_t *const out)
+{
+	trace_lock(lock, "wait cache lock");
+
+	auto it = index.find(key);
+	if (it == index.end()) {
+		n_misses++;
+		lock.unlock();
+
+		return false;
+	}
+
+	lru.splice(lru.begin(), lru, it->second);
+
+	*out = it->second->second;
+
+	n_hits++;
+	lock.unlock();
+
+	return true;
+}
+
+void texture_cache::put(const std::string & key, const entry_t & e)
+{
+	if (max_entries == 0 || !e.t)
+		return;
+
+	trace_lock(lock, "wait cache lock");
+
+	// rasterized in parallel by another thread
+	if (index.find(key) != index.end()) {
+		lock.unlock();
+
+		return;
+	}
+
+	lru.push_front({ key, e });
+	index.insert({ key, lru.begin() });
+	bytes += entry_bytes(e);
+
+	// a texture that is still shown stays alive through the render state
+	while(lru.size() > max_entries) {
+		bytes -= entry_bytes(lru.back().second);
+		index.erase(lru.back().first);
+		lru.pop_back();
+	}
+
+	lock.unlock();
+}
+
+bool texture_cache::evict_cold()
+{
+	trace_lock(lock, "wait cache lock");
+
+	for(auto it = lru.rbegin(); it != lru.rend(); it++) {
+		// also referred to by a render state
+		if (it->second.t.use_count() > 1)
+			continue;
+
+		bytes -= entry_bytes(it->second);
+		index.erase(it->first);
+		lru.erase(std::next(it).base());
+
+		lock.unlock();
+
+		return true;
+	}
+
+	lock.unlock();
+
+	return false;
+}
+
+texture_cache_stats_t texture_cache::get_stats()
+{
+	trace_lock(lock, "wait cache lock");
+	texture_cache_stats_t s { n_hits, n_misses, bytes, lru.size() };
+	lock.unlock();
+
+	return s;
+}
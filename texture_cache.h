@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <SDL2/SDL.h>
+
+#include "texture_budget.h"
+
+
+typedef struct
+{
+	uint64_t n_hits;
+	uint64_t n_misses;
+	uint64_t bytes;     // approximate texture memory held
+	size_t   n_entries;
+} texture_cache_stats_t;
+
+// Bounded LRU of rasterized strings. Boxes that cycle between a few values
+// ("ON"/"OFF", the hour of the day) then rasterize each of them only once.
+// The key is the text only: a cache belongs to one container, so the font
+// and the wrap width are fixed, and text is rasterized in white and colored
+// when drawn.
+class texture_cache
+{
+public:
+	typedef struct {
+		std::shared_ptr<texture> t;
+		int w, h;
+		int line_h;
+	} entry_t;
+
+private:
+	const size_t max_entries { 0 };
+
+	std::mutex lock;
+	// most recently used first
+	std::list<std::pair<std::string, entry_t> > lru;
+	std::unordered_map<std::string, std::list<std::pair<std::string, entry_t> >::iterator> index;
+
+	uint64_t n_hits   { 0 };
+	uint64_t n_misses { 0 };
+	uint64_t bytes    { 0 };
+
+public:
+	texture_cache(const size_t max_entries);
+	virtual ~texture_cache();
+
+	bool get(const std::string & key, entry_t *const out);
+	void put(const std::string & key, const entry_t & e);
+
+	// drops the least recently used texture that is not shown, if any;
+	// invoked when over the texture budget
+	bool evict_cold();
+
+	texture_cache_stats_t get_stats();
+};
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "error.h"
+#include "time_zone.h"
+
+
+static uint32_t get_be32(const uint8_t *const p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+static int64_t get_be64(const uint8_t *const p)
+{
+	return int64_t((uint64_t(get_be32(p)) << 32) | get_be32(p + 4));
+}
+
+// days since 1970-01-01 of a date in the proleptic Gregorian calendar
+static int64_t days_from_civil(int y, const int m, const int d)
+{
+	y -= m <= 2;
+
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const int     yoe = int(y - era * 400);
+	const int     doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const int     doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+static bool is_leap(const int y)
+{
+	return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+// "CET" or "<+0530>"
+static bool parse_abbr(const char **const p, std::string *const out)
+{
+	const char *start = *p;
+
+	if (*start == '<') {
+		const char *end = strchr(start, '>');
+		if (!end)
+			return false;
+
+		*out = std::string(start + 1, end);
+		*p   = end + 1;
+	}
+	else {
+		const char *end = start;
+		while(isalpha(*end))
+			end++;
+
+		*out = std::string(start, end);
+		*p   = end;
+	}
+
+	return out->size() >= 3;
+}
+
+// [+-]hh[:mm[:ss]], in seconds
+static bool parse_hms(const char **const p, int32_t *const out)
+{
+	const char *cur  = *p;
+	int         sign = 1;
+
+	if (*cur == '+' || *cur == '-')
+		sign = *cur++ == '-' ? -1 : 1;
+
+	if (!isdigit(*cur))
+		return false;
+
+	int32_t v = 0;
+
+	for(int part=0; part<3; part++) {
+		if (part > 0) {
+			if (*cur != ':' || !isdigit(cur[1]))
+				break;
+
+			cur++;
+		}
+
+		int32_t n = 0;
+		while(isdigit(*cur) && n < 1000)
+			n = n * 10 + *cur++ - '0';
+
+		v += n * (part == 0 ? 3600 : part == 1 ? 60 : 1);
+	}
+
+	*out = sign * v;
+	*p   = cur;
+
+	return true;
+}
+
+static bool parse_number(const char **const p, int *const out)
+{
+	if (!isdigit(**p))
+		return false;
+
+	int n = 0;
+	while(isdigit(**p) && n < 1000)
+		n = n * 10 + *(*p)++ - '0';
+
+	*out = n;
+
+	return true;
+}
+
+time_zone::time_zone(const std::string & name)
+{
+	// nothing outside of the tzdata directory
+	if (name.find("..") == std::string::npos && load_tzif("/usr/share/zoneinfo/" + name))
+		return;
+
+	transitions.clear();
+	transition_types.clear();
+	types.clear();
+
+	if (parse_rule(name))
+		return;
+
+	error_exit(false, "timezone \"%s\" is unknown", name.c_str());
+}
+
+time_zone::~time_zone()
+{
+}
+
+// RFC 8536
+bool time_zone::load_tzif(const std::string & file)
+{
+	FILE *fh = fopen(file.c_str(), "rb");
+	if (!fh)
+		return false;
+
+	std::vector<uint8_t> data;
+	uint8_t buffer[4096];
+
+	for(;;) {
+		size_t n = fread(buffer, 1, sizeof buffer, fh);
+		if (n == 0)
+			break;
+
+		data.insert(data.end(), buffer, buffer + n);
+	}
+
+	fclose(fh);
+
+	size_t offset    = 0;
+	int    time_size = 4;
+
+	for(;;) {
+		if (data.size() < offset + 44 || memcmp(&data[offset], "TZif", 4) != 0)
+			return false;
+
+		const uint8_t *h        = &data[offset];
+		const char     version  = char(h[4]);
+		const uint32_t isutcnt  = get_be32(h + 20);
+		const uint32_t isstdcnt = get_be32(h + 24);
+		const uint32_t leapcnt  = get_be32(h + 28);
+		const uint32_t timecnt  = get_be32(h + 32);
+		const uint32_t typecnt  = get_be32(h + 36);
+		const uint32_t charcnt  = get_be32(h + 40);
+
+		const uint64_t block = uint64_t(timecnt) * time_size + timecnt + uint64_t(typecnt) * 6 + charcnt + uint64_t(leapcnt) * (time_size + 4) + isstdcnt + isutcnt;
+
+		offset += 44;
+
+		if (data.size() < offset + block || typecnt == 0)
+			return false;
+
+		// version 1 only has 32 bit times: skip to the 64 bit data
+		if (time_size == 4 && version >= '2') {
+			offset += block;
+			time_size = 8;
+
+			continue;
+		}
+
+		const uint8_t *p = &data[offset];
+
+		transitions.clear();
+		transition_types.clear();
+		types.clear();
+
+		for(uint32_t i=0; i<timecnt; i++, p += time_size)
+			transitions.push_back(time_size == 8 ? get_be64(p) : int32_t(get_be32(p)));
+
+		for(uint32_t i=0; i<timecnt; i++, p++) {
+			if (*p >= typecnt)
+				return false;
+
+			transition_types.push_back(*p);
+		}
+
+		const char *chars = reinterpret_cast<const char *>(p + typecnt * 6);
+
+		for(uint32_t i=0; i<typecnt; i++, p += 6) {
+			uint8_t idx = p[5];
+			if (idx >= charcnt)
+				return false;
+
+			types.push_back({ int32_t(get_be32(p)), p[4] != 0, std::string(chars + idx, strnlen(chars + idx, charcnt - idx)) });
+		}
+
+		offset += block;
+
+		break;
+	}
+
+	// the footer: how it goes on after the last transition
+	if (time_size == 8 && offset < data.size() && data[offset] == '\n') {
+		auto end = std::find(data.begin() + offset + 1, data.end(), '\n');
+
+		std::string rule(data.begin() + offset + 1, end);
+
+		if (rule.empty() == false && parse_rule(rule) == false)
+			has_rule = false;
+	}
+
+	return true;
+}
+
+// std offset [dst [offset] [,start[/time],end[/time]]]
+bool time_zone::parse_rule(const std::string & rule)
+{
+	const char *p = rule.c_str();
+
+	int32_t offset = 0;
+	if (!parse_abbr(&p, &rule_std.abbr) || !parse_hms(&p, &offset))
+		return false;
+
+	// POSIX counts west of UTC as positive
+	rule_std.utoff = -offset;
+	has_dst        = false;
+
+	if (*p) {
+		if (!parse_abbr(&p, &rule_dst.abbr))
+			return false;
+
+		rule_dst.utoff = rule_std.utoff + 3600;
+
+		if (*p && *p != ',') {
+			if (!parse_hms(&p, &offset))
+				return false;
+
+			rule_dst.utoff = -offset;
+		}
+
+		// without dates: the US rules, as glibc does
+		rule_date_t *dates[] { &dst_start, &dst_end };
+
+		for(auto rd : dates) {
+			if (*p == 0)
+				break;
+
+			if (*p++ != ',')
+				return false;
+
+			rd->time = 7200;
+
+			if (*p == 'M') {
+				p++;
+
+				rd->kind = 'M';
+
+				if (!parse_number(&p, &rd->m) || *p++ != '.' || !parse_number(&p, &rd->w) || *p++ != '.' || !parse_number(&p, &rd->d))
+					return false;
+
+				if (rd->m < 1 || rd->m > 12 || rd->w < 1 || rd->w > 5 || rd->d > 6)
+					return false;
+			}
+			else {
+				rd->kind = 'n';
+
+				if (*p == 'J') {
+					p++;
+
+					rd->kind = 'J';
+				}
+
+				if (!parse_number(&p, &rd->n) || rd->n > 365 || (rd->kind == 'J' && rd->n == 0))
+					return false;
+			}
+
+			if (*p == '/') {
+				p++;
+
+				if (!parse_hms(&p, &rd->time))
+					return false;
+			}
+		}
+
+		has_dst = true;
+	}
+
+	if (*p)
+		return false;
+
+	has_rule = true;
+
+	return true;
+}
+
+// in UTC; rd.time is in the local time that is in effect before it
+int64_t time_zone::rule_transition(const int year, const rule_date_t & rd, const int32_t utoff) const
+{
+	int64_t day = 0;
+
+	if (rd.kind == 'M') {
+		static const int month_days[] { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+		int64_t first  = days_from_civil(year, rd.m, 1);
+		int     wd     = int(((first + 4) % 7 + 7) % 7);  // 1970-01-01 was a thursday
+		int     n_days = month_days[rd.m - 1] + (rd.m == 2 && is_leap(year));
+		int     mday   = (rd.d - wd + 7) % 7 + (rd.w - 1) * 7;
+
+		// week 5 is the last one
+		if (mday >= n_days)
+			mday -= 7;
+
+		day = first + mday;
+	}
+	else if (rd.kind == 'J') {
+		day = days_from_civil(year, 1, 1) + rd.n - 1 + (is_leap(year) && rd.n >= 60);
+	}
+	else {
+		day = days_from_civil(year, 1, 1) + rd.n;
+	}
+
+	return day * 86400 + rd.time - utoff;
+}
+
+const time_zone::type_t & time_zone::type_at(const int64_t t) const
+{
+	if (transitions.empty() == false && t < transitions.back()) {
+		if (t < transitions.front())
+			return types.front();
+
+		size_t idx = std::upper_bound(transitions.begin(), transitions.end(), t) - transitions.begin() - 1;
+
+		return types.at(transition_types.at(idx));
+	}
+
+	if (!has_rule)
+		return transitions.empty() ? types.front() : types.at(transition_types.back());
+
+	if (!has_dst)
+		return rule_std;
+
+	time_t    local = time_t(t + rule_std.utoff);
+	struct tm tm { };
+	gmtime_r(&local, &tm);
+
+	int     year  = tm.tm_year + 1900;
+	int64_t start = rule_transition(year, dst_start, rule_std.utoff);
+	int64_t end   = rule_transition(year, dst_end,   rule_dst.utoff);
+
+	// on the southern hemisphere daylight saving time spans new year
+	bool dst = start < end ? t >= start && t < end : !(t >= end && t < start);
+
+	return dst ? rule_dst : rule_std;
+}
+
+void time_zone::to_tm(const time_t t, struct tm *const tm) const
+{
+	const type_t & type = type_at(t);
+
+	time_t local = t + type.utoff;
+	gmtime_r(&local, tm);
+
+	tm->tm_isdst  = type.is_dst;
+	tm->tm_gmtoff = type.utoff;
+	tm->tm_zone   = type.abbr.c_str();
+}
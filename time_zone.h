@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <time.h>
+#include <vector>
+
+
+// Converts UTC to the local time of one timezone without touching TZ, which
+// is process wide and inherited by exec'd children. The tzdata file (e.g.
+// /usr/share/zoneinfo/Europe/Amsterdam) is read once; a name that is not in
+// it is taken as a POSIX TZ string ("CET-1CEST,M3.5.0,M10.5.0/3").
+class time_zone
+{
+private:
+	typedef struct {
+		int32_t     utoff;  // seconds east of UTC
+		bool        is_dst;
+		std::string abbr;
+	} type_t;
+
+	// "Mm.w.d" (kind 'M'), "Jn" (1...365, no leap day) or "n" (0...365)
+	typedef struct {
+		char    kind;
+		int     m, w, d, n;
+		int32_t time;  // seconds after local midnight
+	} rule_date_t;
+
+	std::vector<int64_t> transitions;
+	std::vector<uint8_t> transition_types;
+	std::vector<type_t>  types;
+
+	// after the last transition (or without tzdata file)
+	bool        has_rule { false };
+	type_t      rule_std { 0, false, "" };
+	type_t      rule_dst { 0, true,  "" };
+	bool        has_dst  { false };
+	rule_date_t dst_start { 'M', 3, 2, 0, 0, 7200 };
+	rule_date_t dst_end   { 'M', 11, 1, 0, 0, 7200 };
+
+	bool load_tzif(const std::string & file);
+	bool parse_rule(const std::string & rule);
+	int64_t rule_transition(const int year, const rule_date_t & rd, const int32_t utoff) const;
+	const type_t & type_at(const int64_t t) const;
+
+public:
+	time_zone(const std::string & name);
+	virtual ~time_zone();
+
+	// also sets tm_gmtoff and tm_zone (for %z and %Z); tm_zone points
+	// into this object
+	void to_tm(const time_t t, struct tm *const tm) const;
+};
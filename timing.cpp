@@ -0,0 +1,12 @@
+#include <cstdint>
+#include <time.h>
+
+
+// monotonic, in microseconds
+uint64_t get_us()
+{
+	struct timespec ts { 0, 0 };
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
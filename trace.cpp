@@ -0,0 +1,132 @@
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+
+#ifdef WITH_TRACE
+typedef struct
+{
+	const char *name;
+	uint64_t    start_us;
+	uint64_t    duration_us;
+} trace_event_t;
+
+// spans after this are dropped (24 MB per thread)
+constexpr const size_t max_events_per_thread = 1024 * 1024;
+
+typedef struct
+{
+	trace_event_t     *events;
+	std::atomic_size_t n;       // written by the owning thread only
+	pid_t              tid;
+	std::string        name;    // protected by buffers_lock
+} trace_buffer_t;
+
+static std::mutex                    buffers_lock;
+static std::vector<trace_buffer_t *> buffers;
+
+static thread_local trace_buffer_t  *buffer { nullptr };
+
+static trace_buffer_t *get_buffer()
+{
+	if (!buffer) {
+		buffer = new trace_buffer_t;
+		buffer->events = new trace_event_t[max_events_per_thread];
+		buffer->n      = 0;
+		buffer->tid    = syscall(SYS_gettid);
+
+		// only when a thread produces its first span
+		buffers_lock.lock();
+		buffers.push_back(buffer);
+		buffers_lock.unlock();
+	}
+
+	return buffer;
+}
+
+void trace_add(const char *const name, const uint64_t start_us, const uint64_t end_us)
+{
+	trace_buffer_t *b = get_buffer();
+
+	size_t n = b->n.load(std::memory_order_relaxed);
+	if (n >= max_events_per_thread)
+		return;
+
+	b->events[n] = { name, start_us, end_us - start_us };
+
+	// publish the event to trace_write
+	b->n.store(n + 1, std::memory_order_release);
+}
+
+void trace_thread_name(const std::string & name)
+{
+	trace_buffer_t *b = get_buffer();
+
+	buffers_lock.lock();
+	b->name = name;
+	buffers_lock.unlock();
+}
+
+static std::string json_escape(const std::string & in)
+{
+	std::string out;
+
+	for(auto c : in) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+
+		if (uint8_t(c) >= 32)
+			out += c;
+	}
+
+	return out;
+}
+
+bool trace_write(const std::string & file)
+{
+	FILE *fh = fopen(file.c_str(), "w");
+	if (!fh)
+		return false;
+
+	const pid_t pid = getpid();
+
+	fprintf(fh, "{\"traceEvents\":[\n");
+
+	bool first = true;
+
+	buffers_lock.lock();
+
+	for(auto b : buffers) {
+		if (b->name.empty() == false) {
+			fprintf(fh, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", pid, b->tid, json_escape(b->name).c_str());
+			first = false;
+		}
+
+		size_t n = b->n.load(std::memory_order_acquire);
+
+		for(size_t i=0; i<n; i++) {
+			const trace_event_t & e = b->events[i];
+
+			fprintf(fh, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 "}", first ? "" : ",\n", e.name, pid, b->tid, e.start_us, e.duration_us);
+			first = false;
+		}
+	}
+
+	buffers_lock.unlock();
+
+	fprintf(fh, "\n]}\n");
+
+	return fclose(fh) == 0;
+}
+#else
+bool trace_write(const std::string & file)
+{
+	return false;
+}
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "timing.h"
+
+
+// Span tracing, only compiled in with -DWITH_TRACE (cmake -DWITH_TRACE=ON).
+// Each thread appends to its own buffer; trace_write() stores all of them
+// in the Chrome trace format (chrome://tracing, ui.perfetto.dev).
+// Span names must be string literals: only the pointer is stored.
+
+#ifdef WITH_TRACE
+void trace_add(const char *const name, const uint64_t start_us, const uint64_t end_us);
+
+void trace_thread_name(const std::string & name);
+
+class trace_span
+{
+private:
+	const char *const name     { nullptr };
+	const uint64_t    start_us { 0       };
+
+public:
+	trace_span(const char *const name) : name(name), start_us(get_us()) {
+	}
+
+	~trace_span() {
+		trace_add(name, start_us, get_us());
+	}
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT2(a, b)
+#define TRACE_SPAN(name)    trace_span TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define TRACE_SPAN(name)    do { } while(0)
+#endif
+
+// lock m; the time spent waiting for it becomes a span
+inline void trace_lock(std::mutex & m, const char *const name)
+{
+#ifdef WITH_TRACE
+	uint64_t start_us = get_us();
+	m.lock();
+	trace_add(name, start_us, get_us());
+#else
+	m.lock();
+#endif
+}
+
+// false when not compiled in or on a write error
+bool trace_write(const std::string & file);
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+
+// Hands the most recent T from one producer to one consumer without either
+// side ever waiting for the other. The producer fills write_slot() and calls
+// publish(); the consumer calls update() and then uses read_slot(). A slot
+// is only ever accessed by one side at a time, so what is left in
+// write_slot() after publish() is no longer seen by the consumer and can be
+// released or reused.
+// Multiple producers must serialize among themselves.
+template <typename T>
+class triple_buffer
+{
+private:
+	T slots[3] { };
+
+	// index of the middle slot, bit 2 set when it holds data the consumer has not seen
+	std::atomic_uint8_t middle { 1 };
+	uint8_t back  { 0 };  // producer only
+	uint8_t front { 2 };  // consumer only
+
+	static constexpr uint8_t fresh = 4;
+
+public:
+	triple_buffer() {
+	}
+
+	virtual ~triple_buffer() {
+	}
+
+	T & write_slot() {
+		return slots[back];
+	}
+
+	void publish() {
+		back = middle.exchange(back | fresh, std::memory_order_acq_rel) & 3;
+	}
+
+	// returns true if read_slot() changed
+	bool update() {
+		if ((middle.load(std::memory_order_acquire) & fresh) == 0)
+			return false;
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+
+		return true;
+	}
+
+	const T & read_slot() const {
+		return slots[front];
+	}
+
+	// for cleaning up, when neither side is active anymore
+	T & get(const int nr) {
+		return slots[nr];
+	}
+};